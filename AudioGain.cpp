@@ -0,0 +1,146 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define AUDIOGAIN_X86
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define AUDIOGAIN_NEON
+#endif
+
+#include "AudioGain.h"
+
+static void GainScalar(int16_t *dst, const int16_t *src, std::size_t count, int32_t num)
+{
+	for (std::size_t i=0; i<count; i++)
+	{
+		const int32_t v = (int32_t(src[i]) * num) >> 8;
+		dst[i] = int16_t((v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : v));
+	}
+}
+
+#ifdef AUDIOGAIN_X86
+
+// the low and high halves of the 16x16 bit products make the full 32-bit products,
+// which are shifted and then packed back to 16 bits with signed saturation
+__attribute__((target("sse2")))
+static void GainSSE2(int16_t *dst, const int16_t *src, std::size_t count, int32_t num)
+{
+	const __m128i n = _mm_set1_epi16(int16_t(num));
+	std::size_t i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+		const __m128i lo = _mm_mullo_epi16(v, n);
+		const __m128i hi = _mm_mulhi_epi16(v, n);
+		const __m128i a = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8);
+		const __m128i b = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8);
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+	}
+	GainScalar(dst + i, src + i, count - i, num);
+}
+
+// the unpacks and the pack both work inside each 128-bit lane, so the order comes out right
+__attribute__((target("avx2")))
+static void GainAVX2(int16_t *dst, const int16_t *src, std::size_t count, int32_t num)
+{
+	const __m256i n = _mm256_set1_epi16(int16_t(num));
+	std::size_t i = 0;
+	for (; i+16<=count; i+=16)
+	{
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+		const __m256i lo = _mm256_mullo_epi16(v, n);
+		const __m256i hi = _mm256_mulhi_epi16(v, n);
+		const __m256i a = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 8);
+		const __m256i b = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 8);
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i), _mm256_packs_epi32(a, b));
+	}
+	_mm256_zeroupper();	// or the SSE2 code pays for the AVX to SSE transition
+	GainSSE2(dst + i, src + i, count - i, num);
+}
+
+#endif
+
+#ifdef AUDIOGAIN_NEON
+
+static void GainNEON(int16_t *dst, const int16_t *src, std::size_t count, int32_t num)
+{
+	const int16x4_t n = vdup_n_s16(int16_t(num));
+	std::size_t i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const int16x8_t v = vld1q_s16(src + i);
+		const int32x4_t a = vmull_s16(vget_low_s16(v), n);
+		const int32x4_t b = vmull_s16(vget_high_s16(v), n);
+		vst1q_s16(dst + i, vcombine_s16(vqshrn_n_s32(a, 8), vqshrn_n_s32(b, 8)));
+	}
+	GainScalar(dst + i, src + i, count - i, num);
+}
+
+#endif
+
+std::vector<CAudioGain::SImpl> CAudioGain::Impls()
+{
+	std::vector<SImpl> impls { { "scalar", GainScalar } };
+#ifdef AUDIOGAIN_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		impls.push_back({ "SSE2", GainSSE2 });
+	if (__builtin_cpu_supports("avx2"))
+		impls.push_back({ "AVX2", GainAVX2 });
+#endif
+#ifdef AUDIOGAIN_NEON
+	impls.push_back({ "NEON", GainNEON });
+#endif
+	return impls;
+}
+
+// the last one is the fastest
+static const CAudioGain::SImpl best = CAudioGain::Impls().back();
+
+const char *CAudioGain::ImplName()
+{
+	return best.name;
+}
+
+CAudioGain::CAudioGain(int db)
+{
+	SetGain(db);
+}
+
+void CAudioGain::SetGain(int db)
+{
+	// the SIMD versions multiply by a 16-bit numerator, that's more than +42 dB
+	const float n = roundf(256.0f * powf(10.0f, float(db) / 20.0f));
+	num = (n > float(INT16_MAX)) ? INT16_MAX : int32_t(n);
+}
+
+void CAudioGain::Apply(int16_t *dst, const int16_t *src, std::size_t count) const
+{
+	if (IsUnity())
+	{
+		if (dst != src)
+			memcpy(dst, src, count * sizeof(int16_t));
+	}
+	else
+	{
+		best.apply(dst, src, count, num);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// a fixed-point audio gain, dst[i] = (src[i] * numerator) >> 8, copied from src to dst
+// in one pass. a loud sample clips at the int16_t limits instead of wrapping around.
+// the fastest version the CPU supports (AVX2, SSE2, NEON or plain C++) is picked when
+// the program starts, and they all give exactly the same result
+class CAudioGain
+{
+public:
+	CAudioGain(int db = 0);
+	void SetGain(int db);
+
+	int32_t Numerator() const { return num; }
+	bool IsUnity() const { return 256 == num; }
+
+	// dst and src can be the same, but must not otherwise overlap
+	void Apply(int16_t *dst, const int16_t *src, std::size_t count) const;
+
+	// every version this CPU can run, so the benchmark can check and compare them
+	struct SImpl
+	{
+		const char *name;
+		void (*apply)(int16_t *dst, const int16_t *src, std::size_t count, int32_t num);
+	};
+	static std::vector<SImpl> Impls();
+	static const char *ImplName();
+
+private:
+	int32_t num;
+};
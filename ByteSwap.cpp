@@ -0,0 +1,120 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTESWAP_X86
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define BYTESWAP_NEON
+#endif
+
+#include "ByteSwap.h"
+
+// memcpy is how to do an unaligned load or store without breaking any rules,
+// the compiler turns it into a single move
+static void SwapScalar(void *dst, const void *src, std::size_t count)
+{
+	auto d = static_cast<uint8_t *>(dst);
+	auto s = static_cast<const uint8_t *>(src);
+	for (std::size_t i=0; i<count; i++)
+	{
+		uint16_t v;
+		memcpy(&v, s + 2 * i, 2);
+		v = __builtin_bswap16(v);
+		memcpy(d + 2 * i, &v, 2);
+	}
+}
+
+#ifdef BYTESWAP_X86
+
+__attribute__((target("sse2")))
+static void SwapSSE2(void *dst, const void *src, std::size_t count)
+{
+	auto d = static_cast<uint8_t *>(dst);
+	auto s = static_cast<const uint8_t *>(src);
+	std::size_t i = 0;
+	for (; i+8<=count; i+=8)
+	{
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 2 * i));
+		_mm_storeu_si128(reinterpret_cast<__m128i *>(d + 2 * i), _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8)));
+	}
+	SwapScalar(d + 2 * i, s + 2 * i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void SwapAVX2(void *dst, const void *src, std::size_t count)
+{
+	auto d = static_cast<uint8_t *>(dst);
+	auto s = static_cast<const uint8_t *>(src);
+	const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	std::size_t i = 0;
+	for (; i+16<=count; i+=16)
+	{
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + 2 * i));
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(d + 2 * i), _mm256_shuffle_epi8(v, mask));
+	}
+	_mm256_zeroupper();	// or the SSE2 code pays for the AVX to SSE transition
+	SwapSSE2(d + 2 * i, s + 2 * i, count - i);
+}
+
+#endif
+
+#ifdef BYTESWAP_NEON
+
+static void SwapNEON(void *dst, const void *src, std::size_t count)
+{
+	auto d = static_cast<uint8_t *>(dst);
+	auto s = static_cast<const uint8_t *>(src);
+	std::size_t i = 0;
+	for (; i+8<=count; i+=8)
+		vst1q_u8(d + 2 * i, vrev16q_u8(vld1q_u8(s + 2 * i)));
+	SwapScalar(d + 2 * i, s + 2 * i, count - i);
+}
+
+#endif
+
+std::vector<SByteSwapImpl> SwapBytes16Impls()
+{
+	std::vector<SByteSwapImpl> impls { { "scalar", SwapScalar } };
+#ifdef BYTESWAP_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse2"))
+		impls.push_back({ "SSE2", SwapSSE2 });
+	if (__builtin_cpu_supports("avx2"))
+		impls.push_back({ "AVX2", SwapAVX2 });
+#endif
+#ifdef BYTESWAP_NEON
+	impls.push_back({ "NEON", SwapNEON });
+#endif
+	return impls;
+}
+
+// the last one is the fastest
+static const SByteSwapImpl best = SwapBytes16Impls().back();
+
+void SwapBytes16(void *dst, const void *src, std::size_t count)
+{
+	best.swap(dst, src, count);
+}
+
+const char *SwapBytes16Name()
+{
+	return best.name;
+}
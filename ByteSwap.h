@@ -0,0 +1,37 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <vector>
+
+// swaps the bytes of count 16-bit values from src to dst, which is how audio samples go
+// between host order and the big-endian DVSI speech frames. neither pointer has to be
+// aligned. the fastest version the CPU supports (AVX2, SSE2, NEON or plain C++) is
+// picked when the program starts
+void SwapBytes16(void *dst, const void *src, std::size_t count);
+
+// the name of the version SwapBytes16() is using
+const char *SwapBytes16Name();
+
+// every version this CPU can run, so the benchmark can compare them
+struct SByteSwapImpl
+{
+	const char *name;
+	void (*swap)(void *dst, const void *src, std::size_t count);
+};
+std::vector<SByteSwapImpl> SwapBytes16Impls();
@@ -23,6 +23,7 @@
 #include <sstream>
 #include <regex>
 #include "Configure.h"
+#include "DVSIPacket.h"
 
 // ini file keywords
 #define USRPTXGAIN     "UsrpTxGain"
@@ -34,6 +35,14 @@
 #define MODULES        "Modules"
 #define SERVERADDRESS  "ServerAddress"
 #define PORT           "Port"
+#define WORKERTHREADS  "WorkerThreads"
+#define WORKERCPUS     "WorkerCpus"
+#define CHANNELDEPTH   "DvsiChannelDepth"
+#define STANDINDEVICES "StandInDevices"
+#define STANDINLATENCY "StandInLatency"
+#define STANDINBAUD    "StandInBaudRate"
+#define STANDINFAULTS  "StandInFaultPercent"
+#define METRICSPORT    "MetricsPort"
 
 static inline void split(const std::string &s, char delim, std::vector<std::string> &v)
 {
@@ -128,6 +137,72 @@ bool CConfigure::ReadData(const std::string &path)
 			usrp_tx = getSigned(key, value);
 		else if (0 == key.compare(USRPRXGAIN))
 			usrp_rx = getSigned(key, value);
+		else if (0 == key.compare(WORKERTHREADS))
+		{
+			if (0 == value.compare("module"))
+				module_threads = true;
+			else if (0 == value.compare("shared"))
+				module_threads = false;
+			else
+			{
+				std::cerr << "ERROR: " << WORKERTHREADS << " must be 'shared' or 'module', not '" << value << "'. Halt." << std::endl;
+				return true;
+			}
+		}
+		else if (0 == key.compare(CHANNELDEPTH))
+		{
+			auto i = std::stoi(value);
+			if (i < 1 || i > MAX_CHANNEL_DEPTH)
+			{
+				std::cout << "WARNING: " << key << " = " << value << " is out of range. Using " << channel_depth << '!' << std::endl;
+			}
+			else
+				channel_depth = unsigned(i);
+		}
+		else if (0 == key.compare(STANDINDEVICES))
+		{
+			standin_devices.clear();
+			split(value, ',', standin_devices);
+			for (auto &d : standin_devices)
+				trim(d);
+		}
+		else if (0 == key.compare(STANDINLATENCY))
+		{
+			auto i = std::stoi(value);
+			if (i < 0 || i > 1000000)
+				std::cout << "WARNING: " << key << " = " << value << " is out of range. Using " << standin_latency << '!' << std::endl;
+			else
+				standin_latency = unsigned(i);
+		}
+		else if (0 == key.compare(STANDINBAUD))
+		{
+			auto i = std::stoi(value);
+			if (i < 0)
+				std::cout << "WARNING: " << key << " = " << value << " is out of range. Using the device's own rate!" << std::endl;
+			else
+				standin_baudrate = i;
+		}
+		else if (0 == key.compare(STANDINFAULTS))
+		{
+			auto d = std::stod(value);
+			if (d < 0.0 || d > 100.0)
+				std::cout << "WARNING: " << key << " = " << value << " is out of range. Using " << standin_faults << '!' << std::endl;
+			else
+				standin_faults = d;
+		}
+		else if (0 == key.compare(METRICSPORT))
+		{
+			auto i = std::stoi(value);
+			if (i < 0 || i > 65535)
+				std::cout << "WARNING: " << key << " = " << value << " is out of range. The metrics are off!" << std::endl;
+			else
+				metrics_port = uint16_t(i);
+		}
+		else if (0 == key.compare(WORKERCPUS))
+		{
+			if (getCpus(key, value))
+				return true;
+		}
 		else
 			badParam(key);
 	}
@@ -171,6 +246,35 @@ bool CConfigure::ReadData(const std::string &path)
 	std::cout << DMRGAINOUT << " = " << dmr_out << std::endl;
 	std::cout << USRPTXGAIN << " = " << usrp_tx << std::endl;
 	std::cout << USRPRXGAIN << " = " << usrp_rx << std::endl;
+	std::cout << CHANNELDEPTH << " = " << channel_depth << std::endl;
+	std::cout << WORKERTHREADS << " = " << (module_threads ? "module" : "shared") << std::endl;
+	if (! standin_devices.empty())
+	{
+		std::cout << STANDINDEVICES << " =";
+		for (const auto &d : standin_devices)
+			std::cout << " '" << d << "'";
+		std::cout << std::endl;
+		std::cout << STANDINLATENCY << " = " << standin_latency << std::endl;
+		if (standin_baudrate >= 0)
+			std::cout << STANDINBAUD << " = " << standin_baudrate << std::endl;
+		std::cout << STANDINFAULTS << " = " << standin_faults << std::endl;
+	}
+	if (metrics_port)
+	{
+		if (metrics_port == port)
+		{
+			std::cerr << "ERROR: " << METRICSPORT << " can't be the same as " << PORT << ". Halt." << std::endl;
+			return true;
+		}
+		std::cout << METRICSPORT << " = " << metrics_port << std::endl;
+	}
+	if (! worker_cpus.empty())
+	{
+		std::cout << WORKERCPUS << " =";
+		for (auto cpu : worker_cpus)
+			std::cout << ' ' << cpu;
+		std::cout << std::endl;
+	}
 
 	return false;
 }
@@ -191,6 +295,26 @@ int CConfigure::getSigned(const std::string &key, const std::string &value) cons
 	return i;
 }
 
+// a comma separated list of cpu numbers
+// returns true on failure
+bool CConfigure::getCpus(const std::string &key, const std::string &value)
+{
+	std::vector<std::string> cpus;
+	split(value, ',', cpus);
+	worker_cpus.clear();
+	for (auto &cpu : cpus)
+	{
+		trim(cpu);
+		if (cpu.empty() || std::string::npos != cpu.find_first_not_of("0123456789"))
+		{
+			std::cerr << "ERROR: " << key << " = " << value << " is not a list of CPU numbers. Halt." << std::endl;
+			return true;
+		}
+		worker_cpus.push_back(std::stoi(cpu));
+	}
+	return false;
+}
+
 void CConfigure::badParam(const std::string &key) const
 {
 	std::cout << "WARNING: Unexpected parameter: '" << key << "'" << std::endl;
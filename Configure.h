@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 #include <regex>
 
 enum class EGainType { dmrin, dmrout, dstarin, dstarout, usrptx, usrprx };
@@ -34,13 +35,30 @@ public:
 	std::string GetTCMods(void) const { return tcmods; }
 	std::string GetAddress(void) const { return address; }
 	unsigned GetPort(void) const { return port; }
+	bool GetModuleThreads(void) const { return module_threads; }
+	const std::vector<int> &GetWorkerCpus(void) const { return worker_cpus; }
+	unsigned GetChannelDepth(void) const { return channel_depth; }
+	const std::vector<std::string> &GetStandInDevices(void) const { return standin_devices; }
+	unsigned GetStandInLatency(void) const { return standin_latency; }
+	int GetStandInBaudRate(void) const { return standin_baudrate; }
+	double GetStandInFaultPercent(void) const { return standin_faults; }
+	uint16_t GetMetricsPort(void) const { return metrics_port; }
 
 private:
 	// CFGDATA data;
 	std::string tcmods, address;
 	uint16_t port;
 	int dstar_in, dstar_out, dmr_in, dmr_out, usrp_tx, usrp_rx;
+	bool module_threads = false;
+	std::vector<int> worker_cpus;
+	unsigned channel_depth = 2;
+	std::vector<std::string> standin_devices;
+	unsigned standin_latency = 0;
+	int standin_baudrate = -1;	// the real device's rate
+	double standin_faults = 0.0;
+	uint16_t metrics_port = 0;	// no metrics
 
 	int getSigned(const std::string &key, const std::string &value) const;
+	bool getCpus(const std::string &key, const std::string &value);
 	void badParam(const std::string &key) const;
 };
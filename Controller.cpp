@@ -16,7 +16,12 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cerrno>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
@@ -33,29 +38,23 @@
 
 extern CConfigure g_Conf;
 
-int32_t CController::calcNumerator(int32_t db) const
-{
-	float num = 256.0f * powf(10.0f, (float(db)/20.0f));
-
-	return int32_t(roundf(num));
-}
-
 CController::CController() : keep_running(true) {}
 
 bool CController::Start()
 {
-	usrp_rx_num = calcNumerator(g_Conf.GetGain(EGainType::usrprx));
-	usrp_tx_num = calcNumerator(g_Conf.GetGain(EGainType::usrptx));
+	usrp_rx_gain.SetGain(g_Conf.GetGain(EGainType::usrprx));
+	usrp_tx_gain.SetGain(g_Conf.GetGain(EGainType::usrptx));
+	latency.Init(g_Conf.GetTCMods());
 
-	if (InitVocoders() || tcClient.Open(g_Conf.GetAddress(), g_Conf.GetTCMods(), g_Conf.GetPort()))
+	if (packet_pool.Init(g_Conf.GetTCMods().size()) || InitVocoders() || tcClient.Open(g_Conf.GetAddress(), g_Conf.GetTCMods(), g_Conf.GetPort())
+		|| (g_Conf.GetMetricsPort() && metrics_server.Start(g_Conf.GetMetricsPort(), [this](CMetrics &metrics) { Collect(metrics); })))
 	{
 		keep_running = false;
 		return true;
 	}
+	StartWorkers();
+	sendFuture      = std::async(std::launch::async, &CController::ProcessSendThread,   this);
 	reflectorFuture = std::async(std::launch::async, &CController::ReadReflectorThread, this);
-	c2Future        = std::async(std::launch::async, &CController::ProcessC2Thread,     this);
-	imbeFuture      = std::async(std::launch::async, &CController::ProcessIMBEThread,   this);
-	usrpFuture      = std::async(std::launch::async, &CController::ProcessUSRPThread,   this);
 #ifdef USE_SW_AMBE2
 	swambe2Future   = std::async(std::launch::async, &CController::ProcessSWAMBE2Thread,this);
 #endif
@@ -65,17 +64,46 @@ bool CController::Start()
 void CController::Stop()
 {
 	keep_running = false;
+	metrics_server.Stop();
+
+	for (auto &ws : worker_sets)
+	{
+		ws.codec2_queue.Shutdown();
+		ws.imbe_queue.Shutdown();
+		ws.usrp_queue.Shutdown();
+	}
+#ifdef USE_SW_AMBE2
+	swambe2_queue.Shutdown();
+#endif
+
+	send_queue.Shutdown();
 
 	if (reflectorFuture.valid())
 		reflectorFuture.get();
-	if (c2Future.valid())
-		c2Future.get();
+	if (sendFuture.valid())
+		sendFuture.get();
+	for (auto &ws : worker_sets)
+	{
+		if (ws.c2Future.valid())
+			ws.c2Future.get();
+		if (ws.imbeFuture.valid())
+			ws.imbeFuture.get();
+		if (ws.usrpFuture.valid())
+			ws.usrpFuture.get();
+	}
+#ifdef USE_SW_AMBE2
+	if (swambe2Future.valid())
+		swambe2Future.get();
+#endif
+
+	if (send_stats.packets)
+		std::cout << "Sent " << send_stats.packets << " packets in " << send_stats.writes << " writes, send latency average was " << send_stats.latency_total / send_stats.packets / 1000 << " us, maximum was " << send_stats.latency_max / 1000 << " us" << std::endl;
+	latency.Report(std::cout);
+	std::cout << "Packet pool high-water mark was " << packet_pool.HighWater() << " of " << packet_pool.Capacity() << " packets, with " << packet_pool.Misses() << " heap allocations" << std::endl;
 
 	tcClient.Close();
-	dstar_device->CloseDevice();
-	dmrsf_device->CloseDevice();
-	dstar_device.reset();
-	dmrsf_device.reset();
+	dvsi_pool.ReportStats();
+	dvsi_pool.Close();
 }
 
 bool CController::DiscoverFtdiDevices(std::list<std::pair<std::string, std::string>> &found)
@@ -129,48 +157,12 @@ bool CController::InitVocoders()
 	{
 		c2_16[c] = std::unique_ptr<CCodec2>(new CCodec2(false));
 		c2_32[c] = std::unique_ptr<CCodec2>(new CCodec2(true));
-	}
-
-	// the 3000 or 3003 devices
-	std::list<std::pair<std::string, std::string>> deviceset;
-
-	if (DiscoverFtdiDevices(deviceset))
-		return true;
-
-	if (deviceset.empty()) {
-		std::cerr << "could not find a device!" << std::endl;
-		return true;
-	}
-
-	if (2 != deviceset.size())
-	{
-#ifdef USE_SW_AMBE2
-		if(deviceset.size() == 1){
-			std::cout << "Using one DVSI device and md380_vocoder" << std::endl;
-		}
-#else
-		std::cerr << "Could not find exactly two DVSI devices" << std::endl;
-		return true;
-#endif
-	}
-
-	const auto desc(deviceset.front().second);
-	if (deviceset.back().second.compare(desc))
-	{
-		if (desc.compare(0, 9, "USB-3006 ")) // the USB-3006 device doesn't need this check
-		{
-			std::cout << "Both devices should to be the same type: " << desc << " != " << deviceset.back().second << std::endl;
-		}
-	}
-
-	Edvtype dvtype = Edvtype::dv3003;
-	if (0==desc.compare("ThumbDV") || 0==desc.compare("DVstick-30") || 0==desc.compare("USB-3000") || 0==desc.compare("FT230X Basic UART"))
-		dvtype = Edvtype::dv3000;
-
-	if (modules.size() > ((Edvtype::dv3000 == dvtype) ? 1 : 3))
-	{
-		std::cerr << "Too many transcoded modules for the devices" << std::endl;
-		return true;
+		// the stores have to exist before the worker threads start using them
+		memset(audio_store[c], 0, sizeof(audio_store[c]));
+		memset(data_store[c], 0, sizeof(data_store[c]));
+		// and so do the P25 vocoders, they are created when a stream starts
+		p25_enc[c];
+		p25_dec[c];
 	}
 
 	for (unsigned int i=0; i<modules.size(); i++)
@@ -182,109 +174,143 @@ bool CController::InitVocoders()
 		}
 	}
 
-	//initialize each device
-	while (! deviceset.empty())
+	// the DVSI devices, or their stand-ins
+	std::list<std::pair<std::string, std::string>> deviceset;
+	const auto &standins = g_Conf.GetStandInDevices();
+	if (standins.empty())
 	{
-		if (Edvtype::dv3000 == dvtype)
-		{
-			dstar_device = std::unique_ptr<CDVDevice>(new CDV3000(Encoding::dstar));
-#ifdef USE_SW_AMBE2
-			md380_init();
-			ambe_in_num = calcNumerator(g_Conf.GetGain(EGainType::dmrin));
-			ambe_out_num = calcNumerator(g_Conf.GetGain(EGainType::dmrout));
-#else
-			dmrsf_device = std::unique_ptr<CDVDevice>(new CDV3000(Encoding::dmrsf));
-#endif
-		}
-		else
-		{
-			dstar_device = std::unique_ptr<CDVDevice>(new CDV3003(Encoding::dstar));
+		if (DiscoverFtdiDevices(deviceset))
+			return true;
+	}
+	else
+	{
+		for (unsigned int i=0; i<standins.size(); i++)
+			deviceset.emplace_back("SI" + std::to_string(i), standins[i]);
+	}
+
 #ifdef USE_SW_AMBE2
-			md380_init();
+	md380_init();
+	ambe_in_gain.SetGain(g_Conf.GetGain(EGainType::dmrin));
+	ambe_out_gain.SetGain(g_Conf.GetGain(EGainType::dmrout));
+	const bool dmr_in_software = true;
 #else
-			dmrsf_device = std::unique_ptr<CDVDevice>(new CDV3003(Encoding::dmrsf));
+	const bool dmr_in_software = false;
 #endif
-		}
 
-		if (dstar_device)
-		{
-			if (dstar_device->OpenDevice(deviceset.front().first, deviceset.front().second, dvtype, int8_t(g_Conf.GetGain(EGainType::dstarin)), int8_t(g_Conf.GetGain(EGainType::dstarout))))
-				return true;
-			deviceset.pop_front();
-		}
-		else
-		{
-			std::cerr << "Could not create DVSI devices!" << std::endl;
-			return true;
-		}
-#ifndef USE_SW_AMBE2
-		if (dmrsf_device)
-		{
-			if (dmrsf_device->OpenDevice(deviceset.front().first, deviceset.front().second, dvtype, int8_t(g_Conf.GetGain(EGainType::dmrin)), int8_t(g_Conf.GetGain(EGainType::dmrout))))
-				return true;
-			deviceset.pop_front();
-		}
-		else
-		{
-			std::cerr << "Could not create DVSI devices!" << std::endl;
-			return true;
-		}
-#endif
-	}
+	if (dvsi_pool.Open(deviceset, modules, dmr_in_software, ! standins.empty()))
+		return true;
 
-	// and start them (or it) up!
-	dstar_device->Start();
+	// and start them up!
+	dvsi_pool.Start();
 
-#ifndef USE_SW_AMBE2
-	dmrsf_device->Start();
-#endif
+	return false;
+}
 
-	deviceset.clear();
+// create the worker set(s) and start their threads
+void CController::StartWorkers()
+{
+	const std::string modules(g_Conf.GetTCMods());
+	const auto &cpus = g_Conf.GetWorkerCpus();
+	const auto nsets = g_Conf.GetModuleThreads() ? modules.size() : 1u;
 
-	return false;
+	for (unsigned int i=0; i<nsets; i++)
+	{
+		worker_sets.emplace_back();
+		auto &ws = worker_sets.back();
+		if (! cpus.empty())
+			ws.cpu = cpus[i % cpus.size()];
+		ws.c2Future   = std::async(std::launch::async, &CController::ProcessC2Thread,   this, &ws);
+		ws.imbeFuture = std::async(std::launch::async, &CController::ProcessIMBEThread, this, &ws);
+		ws.usrpFuture = std::async(std::launch::async, &CController::ProcessUSRPThread, this, &ws);
+	}
+
+	auto ws = worker_sets.begin();
+	for (auto c : modules)
+	{
+		workers[c] = &(*ws);
+		if (nsets > 1)
+		{
+			std::cout << "Module " << c << " has its own worker threads";
+			if (ws->cpu >= 0)
+				std::cout << " on CPU " << ws->cpu;
+			std::cout << std::endl;
+			ws++;
+		}
+	}
+	if (1 == nsets && worker_sets.front().cpu >= 0)
+		std::cout << "The worker threads are on CPU " << worker_sets.front().cpu << std::endl;
+}
+
+void CController::PinThread(int cpu, const char *name) const
+{
+	if (cpu < 0)
+		return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	auto rval = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (rval)
+		std::cerr << "Could not pin the " << name << " thread to CPU " << cpu << ": " << strerror(rval) << std::endl;
 }
 
 // Encapsulate the incoming STCPacket into a CTranscoderPacket and push it into the appropriate queue
 // based on packet's codec_in.
 void CController::ReadReflectorThread()
 {
+	std::queue<std::unique_ptr<STCPacket>> queue;
 	while (keep_running)
 	{
 		// preemptively check the connection(s)...
-		tcClient.ReConnect();
+		const auto connected = Connected();
+		if (connected < g_Conf.GetTCMods().size())
+		{
+			tcClient.ReConnect();
+			const auto now = Connected();
+			if (now > connected)
+				reconnects += now - connected;
+		}
 
-		std::queue<std::unique_ptr<STCPacket>> queue;
 		// wait up to 100 ms to read something on the unix port
 		tcClient.Receive(queue, 100);
 		while (! queue.empty())
 		{
-			// create a shared pointer to a new packet
+			// get a shared pointer to a new packet from the pool
 			// there is only one CTranscoderPacket created for each new STCPacket received from the reflector
-			auto packet = std::make_shared<CTranscoderPacket>(*queue.front());
+			auto packet = packet_pool.NewPacket(*queue.front());
 			queue.pop();
+			if (workers.end() == workers.find(packet->GetModule()))
+			{
+				unknown_module++;
+				Dump(packet, "ERROR: Received a reflector packet for a module that isn't transcoded:");
+				continue;
+			}
+			if (unsigned(packet->GetCodecIn()) < CLatencyStats::paths)
+				received[packet->GetModule() - 'A'][unsigned(packet->GetCodecIn())].fetch_add(1, std::memory_order_relaxed);
 			switch (packet->GetCodecIn())
 			{
 			case ECodecType::dstar:
-				dstar_device->AddPacket(packet);
+				dvsi_pool.AddPacket(Encoding::dstar, packet);
 				break;
 			case ECodecType::dmr:
 #ifdef USE_SW_AMBE2
-				swambe2_queue.push(packet);
+				Enqueue(swambe2_queue, packet, "SW AMBE2", EStage::swambe2_queued);
 #else
-				dmrsf_device->AddPacket(packet);
+				dvsi_pool.AddPacket(Encoding::dmrsf, packet);
 #endif
 				break;
 			case ECodecType::p25:
-				imbe_queue.push(packet);
+				Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
 				break;
 			case ECodecType::usrp:
-				usrp_queue.push(packet);
+				Enqueue(Workers(packet).usrp_queue, packet, "USRP", EStage::usrp_queued);
 				break;
 			case ECodecType::c2_1600:
 			case ECodecType::c2_3200:
-				codec2_queue.push(packet);
+				Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
 				break;
 			default:
+				unknown_codec++;
 				Dump(packet, "ERROR: Received a reflector packet with unknown Codec:");
 				break;
 			}
@@ -319,17 +345,17 @@ void CController::AudiotoCodec2(std::shared_ptr<CTranscoderPacket> packet)
 	}
 
 	// we might be all done...
-	send_mux.lock();
-	if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-	send_mux.unlock();
+	if (packet->ReadyToSend())
+		SendToReflector(packet);
 }
 
 // The original incoming coded was M17, so we will calculate the audio and then
 // push the packet onto both the dstar and the dmr queue.
 void CController::Codec2toAudio(std::shared_ptr<CTranscoderPacket> packet)
 {
+#ifdef USE_SW_AMBE2
 	uint8_t ambe2[9];
-	uint8_t imbe[11];
+#endif
 
 	if (packet->IsSecond())
 	{
@@ -371,25 +397,29 @@ void CController::Codec2toAudio(std::shared_ptr<CTranscoderPacket> packet)
 			packet->SetAudioSamples(tmp, false);
 		}
 	}
-	// the only thing left is to encode the two ambe, so push the packet onto both AMBE queues
-	dstar_device->AddPacket(packet);
+	// USRP is just a copy, and it has to be set before anything else can complete the packet
+	packet->SetUSRPData(packet->GetAudioSamples(), usrp_tx_gain);
 
 #ifdef USE_SW_AMBE2
 	md380_encode_fec(ambe2, packet->GetAudioSamples());
 	packet->SetDMRData(ambe2);
-#else
-	dmrsf_device->AddPacket(packet);
 #endif
-	p25vocoder.encode_4400((int16_t*)packet->GetAudioSamples(), imbe);
-	packet->SetP25Data(imbe);
-	packet->SetUSRPData((int16_t*)packet->GetAudioSamples());
+	// the only thing left is to encode the two ambe and the imbe, so push the packet onto those queues
+	dvsi_pool.AddPacket(Encoding::dstar, packet);
+#ifndef USE_SW_AMBE2
+	dvsi_pool.AddPacket(Encoding::dmrsf, packet);
+#endif
+	Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
 }
 
-void CController::ProcessC2Thread()
+void CController::ProcessC2Thread(SWorkerSet *ws)
 {
+	PinThread(ws->cpu, "Codec2");
 	while (keep_running)
 	{
-		auto packet = codec2_queue.pop();
+		auto packet = ws->codec2_queue.pop();	// blocks until there is something to pop, unless shutting down
+		if (! packet)
+			continue;
 
 		switch (packet->GetCodecIn())
 		{
@@ -417,46 +447,43 @@ void CController::AudiotoSWAMBE2(std::shared_ptr<CTranscoderPacket> packet)
 	uint8_t ambe2[9];
 	const int16_t *p = packet->GetAudioSamples();
 
-	if (ambe_in_num != 256)
+	if (ambe_in_gain.IsUnity())
+	{
+		md380_encode_fec(ambe2, p);
+	}
+	else
 	{
 		int16_t tmp[160];
-		for(int i = 0; i < 160; ++i)
-			tmp[i] = int16_t((p[i] * ambe_in_num) >> 8);
+		ambe_in_gain.Apply(tmp, p, 160);
 		md380_encode_fec(ambe2, tmp);
 	}
-	else
-		md380_encode_fec(ambe2, p);
 
 	packet->SetDMRData(ambe2);
 
 	// we might be all done...
-	send_mux.lock();
-	if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-	send_mux.unlock();
+	if (packet->ReadyToSend())
+		SendToReflector(packet);
 }
 
 void CController::SWAMBE2toAudio(std::shared_ptr<CTranscoderPacket> packet)
 {
 	int16_t tmp[160];
 	md380_decode_fec(packet->GetDMRData(), tmp);
-	if (ambe_out_num != 256)
-	{
-		for (int i=0; i<160; i++)
-			tmp[i] = (tmp[i] * ambe_out_num) >> 8;
-	}
-	packet->SetAudioSamples(tmp, false);
+	packet->SetAudioSamples(tmp, ambe_out_gain);
 
-	dstar_device->AddPacket(packet);
-	codec2_queue.push(packet);
-	imbe_queue.push(packet);
-	usrp_queue.push(packet);
+	dvsi_pool.AddPacket(Encoding::dstar, packet);
+	Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
+	Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
+	Enqueue(Workers(packet).usrp_queue, packet, "USRP", EStage::usrp_queued);
 }
 
 void CController::ProcessSWAMBE2Thread()
 {
 	while (keep_running)
 	{
-		auto packet = swambe2_queue.pop();
+		auto packet = swambe2_queue.pop();	// blocks until there is something to pop, unless shutting down
+		if (! packet)
+			continue;
 
 		switch (packet->GetCodecIn())
 		{
@@ -480,36 +507,38 @@ void CController::AudiotoIMBE(std::shared_ptr<CTranscoderPacket> packet)
 {
 	uint8_t imbe[11];
 
-	p25vocoder.encode_4400((int16_t *)packet->GetAudioSamples(), imbe);
+	p25_enc.at(packet->GetModule()).Get(packet->GetStreamId()).encode_4400((int16_t *)packet->GetAudioSamples(), imbe);
 	packet->SetP25Data(imbe);
 	// we might be all done...
-	send_mux.lock();
-	if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-	send_mux.unlock();
+	if (packet->ReadyToSend())
+		SendToReflector(packet);
 }
 
 void CController::IMBEtoAudio(std::shared_ptr<CTranscoderPacket> packet)
 {
 	int16_t tmp[160] = { 0 };
-	p25vocoder.decode_4400(tmp, (uint8_t*)packet->GetP25Data());
+	p25_dec.at(packet->GetModule()).Get(packet->GetStreamId()).decode_4400(tmp, (uint8_t*)packet->GetP25Data());
 	packet->SetAudioSamples(tmp, false);
-	dstar_device->AddPacket(packet);
-	codec2_queue.push(packet);
+	dvsi_pool.AddPacket(Encoding::dstar, packet);
+	Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
 
 #ifdef USE_SW_AMBE2
-	swambe2_queue.push(packet);
+	Enqueue(swambe2_queue, packet, "SW AMBE2", EStage::swambe2_queued);
 #else
-	dmrsf_device->AddPacket(packet);
+	dvsi_pool.AddPacket(Encoding::dmrsf, packet);
 #endif
 
-	usrp_queue.push(packet);
+	Enqueue(Workers(packet).usrp_queue, packet, "USRP", EStage::usrp_queued);
 }
 
-void CController::ProcessIMBEThread()
+void CController::ProcessIMBEThread(SWorkerSet *ws)
 {
+	PinThread(ws->cpu, "IMBE");
 	while (keep_running)
 	{
-		auto packet = imbe_queue.pop();
+		auto packet = ws->imbe_queue.pop();	// blocks until there is something to pop, unless shutting down
+		if (! packet)
+			continue;
 
 		switch (packet->GetCodecIn())
 		{
@@ -530,56 +559,37 @@ void CController::ProcessIMBEThread()
 
 void CController::AudiotoUSRP(std::shared_ptr<CTranscoderPacket> packet)
 {
-	const int16_t *p = packet->GetAudioSamples();
-
-	if (usrp_tx_num != 256)
-	{
-		int16_t tmp[160];
-		for(int i = 0; i < 160; ++i)
-			tmp[i] = int16_t((p[i] * usrp_tx_num) >> 8);
-		packet->SetUSRPData(tmp);
-	}
-	else
-		packet->SetUSRPData(p);
-
+	packet->SetUSRPData(packet->GetAudioSamples(), usrp_tx_gain);
 
 	// we might be all done...
-	send_mux.lock();
-	if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-	send_mux.unlock();
+	if (packet->ReadyToSend())
+		SendToReflector(packet);
 }
 
 void CController::USRPtoAudio(std::shared_ptr<CTranscoderPacket> packet)
 {
-	const int16_t *p = packet->GetUSRPData();
+	packet->SetAudioSamples(packet->GetUSRPData(), usrp_rx_gain);
 
-	if (usrp_rx_num != 256)
-	{
-		int16_t tmp[160];
-		for(int i = 0; i < 160; ++i)
-			tmp[i] = int16_t((p[i] * usrp_rx_num) >> 8);
-		packet->SetAudioSamples(tmp, false);
-	}
-	else
-		packet->SetAudioSamples(p, false);
-
-	dstar_device->AddPacket(packet);
-	codec2_queue.push(packet);
+	dvsi_pool.AddPacket(Encoding::dstar, packet);
+	Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
 
 #ifdef USE_SW_AMBE2
-	swambe2_queue.push(packet);
+	Enqueue(swambe2_queue, packet, "SW AMBE2", EStage::swambe2_queued);
 #else
-	dmrsf_device->AddPacket(packet);
+	dvsi_pool.AddPacket(Encoding::dmrsf, packet);
 #endif
 
-	imbe_queue.push(packet);
+	Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
 }
 
-void CController::ProcessUSRPThread()
+void CController::ProcessUSRPThread(SWorkerSet *ws)
 {
+	PinThread(ws->cpu, "USRP");
 	while (keep_running)
 	{
-		auto packet = usrp_queue.pop();
+		auto packet = ws->usrp_queue.pop();	// blocks until there is something to pop, unless shutting down
+		if (! packet)
+			continue;
 
 		switch (packet->GetCodecIn())
 		{
@@ -598,53 +608,314 @@ void CController::ProcessUSRPThread()
 	}
 }
 
+// the software queues are bounded, so if one of them is full, that vocoder thread
+// is hopelessly behind and the packet can't be transcoded in time anyway
+void CController::Enqueue(CPacketQueue &queue, std::shared_ptr<CTranscoderPacket> packet, const char *name, EStage stage)
+{
+	packet->Stamp(stage);
+	if (EQueueStatus::full == queue.push(packet))
+	{
+		queue_full[unsigned(stage)]++;
+		Dump(packet, std::string("ERROR: The ") + name + " queue is full, dropping:");
+	}
+}
+
+// hand a finished packet to the send thread, this never blocks
 void CController::SendToReflector(std::shared_ptr<CTranscoderPacket> packet)
 {
-	// send the packet over the socket
+	if (EQueueStatus::full == send_queue.push(SCompleted { packet, std::chrono::steady_clock::now() }))
+	{
+		send_queue_full++;
+		Dump(packet, "ERROR: The send queue is full, dropping:");
+	}
+}
+
+// the only thread that writes to the reflector
+// everything that finished since the last wakeup is written with one sendmsg() per module
+void CController::ProcessSendThread()
+{
+	SCompleted batch[max_send_batch];
+	struct iovec iov[max_send_batch];
+
+	while (keep_running)
+	{
+		const auto count = send_queue.pop_batch(batch, max_send_batch, std::chrono::milliseconds(100));
+		if (0 == count)
+			continue;
+
+		// the packets for each module go out in order, in one gather write
+		bool done[max_send_batch] = { false };
+		for (std::size_t first=0; first<count; first++)
+		{
+			if (done[first])
+				continue;
+			const char module = batch[first].packet->GetModule();
+			std::size_t n = 0;
+			for (std::size_t i=first; i<count; i++)
+			{
+				if (! done[i] && module == batch[i].packet->GetModule())
+				{
+					iov[n].iov_base = (void *)batch[i].packet->GetTCPacket();
+					iov[n].iov_len = sizeof(STCPacket);
+					n++;
+				}
+			}
+
+			auto sent = WriteToReflector(module, iov, n);
+			const auto now = std::chrono::steady_clock::now();
+			for (std::size_t i=first; i<count; i++)
+			{
+				if (! done[i] && module == batch[i].packet->GetModule())
+				{
+					done[i] = true;
+					// the gather write didn't get this one out, so do it the old way
+					if (sent-- <= 0 && ResendToReflector(batch[i].packet))
+						continue;	// tcd is stopping
+					batch[i].packet->Stamp(EStage::sent);
+					latency.Record(*batch[i].packet);
+					const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - batch[i].when).count();
+					send_stats.latency_total += ns;
+					if (ns > send_stats.latency_max)
+						send_stats.latency_max = ns;
+				}
+			}
+			send_stats.writes++;
+			send_stats.packets += n;
+		}
+
+		for (std::size_t i=0; i<count; i++)
+			batch[i].packet.reset();	// back to the pool
+	}
+}
+
+// sends one packet, reconnecting until it goes, returns true if tcd stopped first
+// a reflector that isn't there is tried less and less often, up to once a second
+bool CController::ResendToReflector(const std::shared_ptr<CTranscoderPacket> &packet)
+{
+	auto backoff = std::chrono::milliseconds(10);
 	while (tcClient.Send(packet->GetTCPacket()))
 	{
+		if (! keep_running)
+			return true;
 		tcClient.ReConnect();
+		std::this_thread::sleep_for(backoff);
+		backoff = std::min(2 * backoff, std::chrono::milliseconds(1000));
 	}
-	packet->Sent();
+	return false;
+}
+
+// returns the number of whole packets written, which can be less than n if there was an error
+int CController::WriteToReflector(char module, struct iovec *iov, std::size_t n)
+{
+	const int fd = tcClient.GetFD(module);
+	if (fd < 0)
+		return 0;
+
+	std::size_t total = n * sizeof(STCPacket), written = 0;
+	struct msghdr msg;
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = iov;
+	msg.msg_iovlen = n;
+	while (written < total)
+	{
+		auto rval = sendmsg(fd, &msg, MSG_NOSIGNAL);
+		if (rval < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			std::cerr << "sendmsg() to module " << module << " failed: " << strerror(errno) << std::endl;
+			// like CTCSocket::Send(), so the caller reconnects before it sends anything else
+			tcClient.Close(module);
+			break;
+		}
+		written += rval;
+		// a short write, skip past what did go out
+		while (msg.msg_iovlen > 0 && std::size_t(rval) >= msg.msg_iov->iov_len)
+		{
+			rval -= msg.msg_iov->iov_len;
+			msg.msg_iov++;
+			msg.msg_iovlen--;
+		}
+		if (rval > 0)
+		{
+			msg.msg_iov->iov_base = (uint8_t *)msg.msg_iov->iov_base + rval;
+			msg.msg_iov->iov_len -= rval;
+		}
+	}
+	// a partially written packet doesn't count, it goes out again, whole, on the new connection
+	return int(written / sizeof(STCPacket));
 }
 
 void CController::RouteDstPacket(std::shared_ptr<CTranscoderPacket> packet)
 {
+	std::unique_lock<std::mutex> lock(dstar_mux);
 	if (ECodecType::dstar == packet->GetCodecIn())
 	{
 		// codec_in is dstar, the audio has just completed, so now calc the M17 and DMR
-		codec2_queue.push(packet);
-		imbe_queue.push(packet);
-		usrp_queue.push(packet);
+		Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
+		Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
+		Enqueue(Workers(packet).usrp_queue, packet, "USRP", EStage::usrp_queued);
 #ifdef USE_SW_AMBE2
-		swambe2_queue.push(packet);
+		Enqueue(swambe2_queue, packet, "SW AMBE2", EStage::swambe2_queued);
 #else
-		dmrsf_device->AddPacket(packet);
+		lock.unlock();
+		dvsi_pool.AddPacket(Encoding::dmrsf, packet);
 #endif
 	}
 	else
 	{
-		send_mux.lock();
-		if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-		send_mux.unlock();
+		if (packet->ReadyToSend())
+			SendToReflector(packet);
 	}
 }
 
 void CController::RouteDmrPacket(std::shared_ptr<CTranscoderPacket> packet)
 {
+	std::unique_lock<std::mutex> lock(dmrst_mux);
 	if (ECodecType::dmr == packet->GetCodecIn())
 	{
-		codec2_queue.push(packet);
-		imbe_queue.push(packet);
-		usrp_queue.push(packet);
-		dstar_device->AddPacket(packet);
+		Enqueue(Workers(packet).codec2_queue, packet, "Codec2", EStage::codec2_queued);
+		Enqueue(Workers(packet).imbe_queue, packet, "IMBE", EStage::imbe_queued);
+		Enqueue(Workers(packet).usrp_queue, packet, "USRP", EStage::usrp_queued);
+		lock.unlock();
+		dvsi_pool.AddPacket(Encoding::dstar, packet);
 	}
 	else
 	{
-		send_mux.lock();
-		if (packet->AllCodecsAreSet() && packet->HasNotBeenSent()) SendToReflector(packet);
-		send_mux.unlock();
+		if (packet->ReadyToSend())
+			SendToReflector(packet);
+	}
+}
+
+// the number of modules connected to the reflector
+unsigned CController::Connected() const
+{
+	unsigned count = 0;
+	for (auto m : g_Conf.GetTCMods())
+	{
+		if (tcClient.GetFD(m) >= 0)
+			count++;
+	}
+	return count;
+}
+
+// everything on the metrics page, this runs on the metrics thread
+// it only reads counters, nothing here waits on the transcoding threads
+void CController::Collect(CMetrics &metrics)
+{
+	const auto &mods = g_Conf.GetTCMods();
+
+	// each worker set is labelled with the modules it serves
+	std::vector<std::pair<std::string, SWorkerSet *>> sets;
+	for (auto &ws : worker_sets)
+	{
+		std::string served;
+		for (auto m : mods)
+		{
+			if (&ws == workers.at(m))
+				served.push_back(m);
+		}
+		sets.emplace_back(CMetrics::Label("modules", served), &ws);
+	}
+	struct SQueue
+	{
+		std::string labels;
+		std::size_t size, high_water, capacity;
+	};
+	std::vector<SQueue> queues;
+	for (const auto &s : sets)
+	{
+		queues.push_back(SQueue { "queue=\"codec2\"," + s.first, s.second->codec2_queue.Size(), s.second->codec2_queue.HighWater(), s.second->codec2_queue.Capacity() });
+		queues.push_back(SQueue { "queue=\"imbe\"," + s.first, s.second->imbe_queue.Size(), s.second->imbe_queue.HighWater(), s.second->imbe_queue.Capacity() });
+		queues.push_back(SQueue { "queue=\"usrp\"," + s.first, s.second->usrp_queue.Size(), s.second->usrp_queue.HighWater(), s.second->usrp_queue.Capacity() });
 	}
+#ifdef USE_SW_AMBE2
+	queues.push_back(SQueue { "queue=\"swambe2\"," + CMetrics::Label("modules", mods), swambe2_queue.Size(), swambe2_queue.HighWater(), swambe2_queue.Capacity() });
+#endif
+	queues.push_back(SQueue { "queue=\"send\"," + CMetrics::Label("modules", mods), send_queue.Size(), send_queue.HighWater(), send_queue.Capacity() });
+
+	metrics.Family("tcd_queue_depth", "gauge", "Packets waiting in a software queue");
+	for (const auto &q : queues)
+		metrics.Sample("tcd_queue_depth", q.labels, uint64_t(q.size));
+	metrics.Family("tcd_queue_high_water", "gauge", "The most packets that have been in a software queue at once");
+	for (const auto &q : queues)
+		metrics.Sample("tcd_queue_high_water", q.labels, uint64_t(q.high_water));
+	metrics.Family("tcd_queue_capacity", "gauge", "The most packets a software queue can hold");
+	for (const auto &q : queues)
+		metrics.Sample("tcd_queue_capacity", q.labels, uint64_t(q.capacity));
+
+	metrics.Family("tcd_dropped_packets_total", "counter", "Packets that were dropped, by why");
+	const std::pair<EStage, const char *> full[] { { EStage::codec2_queued, "codec2" }, { EStage::imbe_queued, "imbe" }, { EStage::usrp_queued, "usrp" }, { EStage::swambe2_queued, "swambe2" } };
+	for (const auto &f : full)
+		metrics.Sample("tcd_dropped_packets_total", std::string("reason=\"queue_full\",queue=\"") + f.second + '"', uint64_t(queue_full[unsigned(f.first)]));
+	metrics.Sample("tcd_dropped_packets_total", "reason=\"queue_full\",queue=\"send\"", uint64_t(send_queue_full));
+	metrics.Sample("tcd_dropped_packets_total", "reason=\"unknown_module\"", uint64_t(unknown_module));
+	metrics.Sample("tcd_dropped_packets_total", "reason=\"unknown_codec\"", uint64_t(unknown_codec));
+
+	// the module and input codec of every path that has seen a packet
+	std::vector<std::pair<std::string, std::pair<char, ECodecType>>> paths;
+	for (auto m : mods)
+	{
+		for (unsigned p=1; p<CLatencyStats::paths; p++)
+		{
+			if (received[m - 'A'][p])
+				paths.emplace_back(CMetrics::Label("module", std::string(1, m)) + ',' + CMetrics::Label("path", CLatencyStats::PathName(ECodecType(p))), std::make_pair(m, ECodecType(p)));
+		}
+	}
+	metrics.Family("tcd_packets_received_total", "counter", "Packets received from the reflector, by module and the codec they came in with");
+	for (const auto &p : paths)
+		metrics.Sample("tcd_packets_received_total", p.first, uint64_t(received[p.second.first - 'A'][unsigned(p.second.second)]));
+	metrics.Family("tcd_packets_sent_total", "counter", "Transcoded packets sent back to the reflector, the rate of this is the frame rate");
+	for (const auto &p : paths)
+		metrics.Sample("tcd_packets_sent_total", p.first, latency.Get(p.second.first, p.second.second, EStage::sent)->Count());
+	metrics.Family("tcd_late_packets_total", "counter", "Packets sent more than 60 ms after they were received");
+	for (const auto &p : paths)
+		metrics.Sample("tcd_late_packets_total", p.first, latency.Late(p.second.first, p.second.second));
+	metrics.Family("tcd_latency_us", "summary", "Time from when a packet was received until it reached the stage, in microseconds, quantiles are bucket upper bounds");
+	for (const auto &p : paths)
+	{
+		for (unsigned s=unsigned(EStage::received)+1; s<unsigned(EStage::count); s++)
+		{
+			const auto h = latency.Get(p.second.first, p.second.second, EStage(s));
+			const auto count = h->Count();
+			if (0 == count)
+				continue;
+			const auto labels = p.first + ',' + CMetrics::Label("stage", CLatencyStats::StageName(EStage(s)));
+			for (const auto q : { 0.5, 0.99, 0.999 })
+			{
+				std::ostringstream quantile;
+				quantile << labels << ",quantile=\"" << q << '"';
+				metrics.Sample("tcd_latency_us", quantile.str(), h->Percentile(q * 100.0));
+			}
+			metrics.Sample("tcd_latency_us_sum", labels, h->Sum());
+			metrics.Sample("tcd_latency_us_count", labels, count);
+		}
+	}
+
+	metrics.Family("tcd_send_latency_us", "summary", "Time a finished packet waited for the send thread, in microseconds");
+	metrics.Sample("tcd_send_latency_us_sum", "", uint64_t(send_stats.latency_total / 1000u));
+	metrics.Sample("tcd_send_latency_us_count", "", uint64_t(send_stats.packets));
+	metrics.Family("tcd_send_latency_max_us", "gauge", "The longest a finished packet waited for the send thread, in microseconds");
+	metrics.Sample("tcd_send_latency_max_us", "", uint64_t(send_stats.latency_max / 1000u));
+	metrics.Family("tcd_send_writes_total", "counter", "Writes to the reflector, each one can have several packets");
+	metrics.Sample("tcd_send_writes_total", "", uint64_t(send_stats.writes));
+
+	metrics.Family("tcd_reflector_connected", "gauge", "1 if the module is connected to the reflector");
+	for (auto m : mods)
+		metrics.Sample("tcd_reflector_connected", CMetrics::Label("module", std::string(1, m)), uint64_t((tcClient.GetFD(m) >= 0) ? 1 : 0));
+	metrics.Family("tcd_reflector_reconnects_total", "counter", "Module connections to the reflector made again after they were lost");
+	metrics.Sample("tcd_reflector_reconnects_total", "", uint64_t(reconnects));
+
+	metrics.Family("tcd_packet_pool_in_use", "gauge", "Packets taken from the packet pool");
+	metrics.Sample("tcd_packet_pool_in_use", "", uint64_t(packet_pool.InUse()));
+	metrics.Family("tcd_packet_pool_high_water", "gauge", "The most packets taken from the packet pool at once");
+	metrics.Sample("tcd_packet_pool_high_water", "", uint64_t(packet_pool.HighWater()));
+	metrics.Family("tcd_packet_pool_capacity", "gauge", "The packets in the packet pool");
+	metrics.Sample("tcd_packet_pool_capacity", "", uint64_t(packet_pool.Capacity()));
+	metrics.Family("tcd_packet_pool_misses_total", "counter", "Packets that came from the heap because the packet pool was empty");
+	metrics.Sample("tcd_packet_pool_misses_total", "", uint64_t(packet_pool.Misses()));
+
+	dvsi_pool.Collect(metrics);
 }
 
 void CController::Dump(const std::shared_ptr<CTranscoderPacket> p, const std::string &title) const
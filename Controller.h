@@ -24,58 +24,122 @@
 #include <mutex>
 #include <list>
 #include <utility>
+#include <chrono>
+#include <sys/uio.h>
 #include <imbe_vocoder_api.h>
 
 #include "codec2.h"
-#include "DV3000.h"
-#include "DV3003.h"
+#include "DevicePool.h"
 #include "TCSocket.h"
+#include "PacketPool.h"
+#include "AudioGain.h"
+#include "Latency.h"
+#include "Metrics.h"
 
-class CController
+// the Codec2, IMBE and USRP worker threads and their input queues
+// depending on WorkerThreads in the ini file, one set serves every module, or each module has its own
+struct SWorkerSet
+{
+	int cpu = -1;	// the cpu the threads are pinned to, or -1 if they aren't pinned
+	CPacketQueue codec2_queue, imbe_queue, usrp_queue;
+	std::future<void> c2Future, imbeFuture, usrpFuture;
+};
+
+// a P25 vocoder for one module and one direction
+// each new stream gets a fresh imbe_vocoder, so no codec state carries over from the last stream
+class CP25Vocoder
 {
 public:
-	std::mutex dstar_mux, dmrst_mux;
+	imbe_vocoder &Get(uint16_t streamid)
+	{
+		if (! vocoder || streamid != sid)
+		{
+			vocoder.reset(new imbe_vocoder);
+			sid = streamid;
+		}
+		return *vocoder;
+	}
+
+private:
+	std::unique_ptr<imbe_vocoder> vocoder;
+	uint16_t sid = 0;
+};
 
+class CController
+{
+public:
 	CController();
 	bool Start();
 	void Stop();
 	void RouteDstPacket(std::shared_ptr<CTranscoderPacket> packet);
 	void RouteDmrPacket(std::shared_ptr<CTranscoderPacket> packet);
 	void Dump(const std::shared_ptr<CTranscoderPacket> packet, const std::string &title) const;
+	// the latency histograms, this doesn't stop anything
+	void ReportLatency(std::ostream &os) const { latency.Report(os); }
 
 protected:
+	// the pool has to outlive everything that might be holding a packet
+	CPacketPool packet_pool;
 	std::atomic<bool> keep_running;
-	std::future<void> reflectorFuture, c2Future, imbeFuture, usrpFuture;
+	std::future<void> reflectorFuture;
+	std::list<SWorkerSet> worker_sets;
+	std::unordered_map<char, SWorkerSet *> workers;	// each module's worker set
 	std::unordered_map<char, int16_t[160]> audio_store;
 	std::unordered_map<char, uint8_t[8]> data_store;
 	CTCClient tcClient;
 	std::unordered_map<char, std::unique_ptr<CCodec2>> c2_16, c2_32;
-	std::unique_ptr<CDVDevice> dstar_device, dmrsf_device;
-
-	CPacketQueue codec2_queue;
+	CDevicePool dvsi_pool;
+	// these keep the routing of each vocoder's finished packets in order. neither is held while
+	// a packet goes to the other vocoder, because that can route a packet of silence, which
+	// takes the other one
+	std::mutex dstar_mux, dmrst_mux;
 
-	CPacketQueue imbe_queue;
-	CPacketQueue usrp_queue;
-	std::mutex send_mux;
-	int32_t ambe_in_num, ambe_out_num, usrp_rx_num, usrp_tx_num;
-	imbe_vocoder p25vocoder;
+	// finished packets waiting for the send thread
+	struct SCompleted
+	{
+		std::shared_ptr<CTranscoderPacket> packet;
+		std::chrono::steady_clock::time_point when;
+	};
+	static constexpr std::size_t max_send_batch = 32;
+	CRingQueue<SCompleted, 512> send_queue;
+	std::future<void> sendFuture;
+	struct SSendStats
+	{
+		// only the send thread writes these
+		std::atomic<uint64_t> packets { 0 }, writes { 0 }, latency_total { 0 }, latency_max { 0 };	// latencies are in ns
+	} send_stats;
+	CLatencyStats latency;	// only the send thread adds to these
+	// more counters for the metrics page
+	std::atomic<uint64_t> received[26][CLatencyStats::paths] {};	// by module and input codec, only the reflector thread writes these
+	std::atomic<uint64_t> queue_full[unsigned(EStage::count)] {};	// packets a full queue dropped, by the stage that queues them
+	std::atomic<uint64_t> send_queue_full { 0 }, unknown_module { 0 }, unknown_codec { 0 }, reconnects { 0 };
+	CMetricsServer metrics_server;
+	CAudioGain ambe_in_gain, ambe_out_gain, usrp_rx_gain, usrp_tx_gain;
+	std::unordered_map<char, CP25Vocoder> p25_enc, p25_dec;	// only used by the module's IMBE thread
 
-	int32_t calcNumerator(int32_t db) const;
 	bool DiscoverFtdiDevices(std::list<std::pair<std::string, std::string>> &found);
 	bool InitVocoders();
+	void StartWorkers();
+	void PinThread(int cpu, const char *name) const;
+	SWorkerSet &Workers(const std::shared_ptr<CTranscoderPacket> &packet) { return *workers.at(packet->GetModule()); }
 	// processing threads
 	void ReadReflectorThread();
-	void ProcessC2Thread();
-
-	void ProcessIMBEThread();
-	void ProcessUSRPThread();
+	void ProcessC2Thread(SWorkerSet *ws);
+	void ProcessIMBEThread(SWorkerSet *ws);
+	void ProcessUSRPThread(SWorkerSet *ws);
 	void Codec2toAudio(std::shared_ptr<CTranscoderPacket> packet);
 	void AudiotoCodec2(std::shared_ptr<CTranscoderPacket> packet);
 	void IMBEtoAudio(std::shared_ptr<CTranscoderPacket> packet);
 	void AudiotoIMBE(std::shared_ptr<CTranscoderPacket> packet);
 	void USRPtoAudio(std::shared_ptr<CTranscoderPacket> packet);
 	void AudiotoUSRP(std::shared_ptr<CTranscoderPacket> packet);
+	void Collect(CMetrics &metrics);
+	unsigned Connected() const;
+	void Enqueue(CPacketQueue &queue, std::shared_ptr<CTranscoderPacket> packet, const char *name, EStage stage);
 	void SendToReflector(std::shared_ptr<CTranscoderPacket> packet);
+	void ProcessSendThread();
+	int WriteToReflector(char module, struct iovec *iov, std::size_t n);
+	bool ResendToReflector(const std::shared_ptr<CTranscoderPacket> &packet);
 #ifdef USE_SW_AMBE2
     std::future<void> swambe2Future;
     CPacketQueue swambe2_queue;
@@ -33,6 +33,7 @@
 #include <thread>
 
 #include "DV3000.h"
+#include "DVSIFrame.h"
 #include "Configure.h"
 #include "Controller.h"
 
@@ -40,91 +41,29 @@ extern CController g_Cont;
 
 CDV3000::CDV3000(Encoding t) : CDVDevice(t) {}
 
-CDV3000::~CDV3000()
-{
-	waiting_packet.Shutdown();
-}
-
-void CDV3000::PushWaitingPacket(unsigned int /* channel */, std::shared_ptr<CTranscoderPacket> packet)
-{
-	waiting_packet.push(packet);
-}
-
-std::shared_ptr<CTranscoderPacket> CDV3000::PopWaitingPacket(unsigned int /* channel */)
-{
-	return waiting_packet.pop();
-}
+CDV3000::~CDV3000() {}
 
-bool CDV3000::SendAudio(const uint8_t /*channel*/, const int16_t *audio) const
+unsigned int CDV3000::FormatAudio(uint8_t *buf, const uint8_t /*channel*/, const int16_t *audio) const
 {
-	// Create Audio packet based on input int8_ts
-	SDV_Packet p;
-	p.start_byte = PKT_HEADER;
-	p.header.payload_length = htons(1 + sizeof(p.payload.audio3k));
-	p.header.packet_type = PKT_SPEECH;
-	p.field_id = PKT_SPEECHD;
-	p.payload.audio3k.num_samples = 160U;
-	for (int i=0; i<160; i++)
-		p.payload.audio3k.samples[i] = htons(audio[i]);
-
-	// send audio packet to DV3000
-	const DWORD size = packet_size(p);
-	DWORD written;
-	auto status = FT_Write(ftHandle, &p, size, &written);
-	if (FT_OK != status)
-	{
-		FTDI_Error("Error writing audio packet", status);
-		return true;
-	}
-	else if (size != written)
-	{
-		std::cerr << "Incomplete Speech Packet write on " << description << std::endl;
-		return true;
-	}
-
-	return false;
+	return WriteSpeech3kFrame(buf, audio);
 }
 
-bool CDV3000::SendData(const uint8_t /* channel */, const uint8_t *data) const
+unsigned int CDV3000::FormatData(uint8_t *buf, const uint8_t /* channel */, const uint8_t *data) const
 {
-	// Create data packet
-	SDV_Packet p;
-	p.start_byte = PKT_HEADER;
-	p.header.payload_length = htons(1 + sizeof(p.payload.ambe3k));
-	p.header.packet_type = PKT_CHANNEL;
-	p.field_id = PKT_CHAND;
-	p.payload.ambe3k.num_bits = 72U;
-	memcpy(p.payload.ambe3k.data, data, 9);
-
-	// send data packet to DV3000
-	const DWORD size = packet_size(p);
-	DWORD written;
-	auto status = FT_Write(ftHandle, &p, size, &written);
-	if (FT_OK != status)
-	{
-		FTDI_Error("Error writing AMBE Packet", status);
-		return true;
-	}
-	else if (size != written)
-	{
-		std::cerr << "Incomplete AMBE Packet write on " << description << std::endl;
-		return true;
-	}
-
-	return false;
+	return WriteChannel3kFrame(buf, data);
 }
 
 void CDV3000::ProcessPacket(const SDV_Packet &p)
 {
-	auto packet = PopWaitingPacket(PKT_CHANNEL0);
+	Encoding encoding;
+	auto packet = PopWaitingPacket(0, encoding);
 	if (packet)
 	{
 		if (PKT_CHANNEL == p.header.packet_type)
 		{
 			if (11!=ntohs(p.header.payload_length) || PKT_CHAND!=p.field_id || 72!=p.payload.ambe3k.num_bits)
 				dump("Improper ambe packet:", &p, packet_size(p));
-			buffer_depth--;
-			if (Encoding::dstar == type)
+			if (Encoding::dstar == encoding)
 				packet->SetDStarData(p.payload.ambe3k.data);
 			else
 				packet->SetDMRData(p.payload.ambe3k.data);
@@ -134,7 +73,6 @@ void CDV3000::ProcessPacket(const SDV_Packet &p)
 		{
 			if (322!=ntohs(p.header.payload_length) || PKT_SPEECHD!=p.field_id || 160!=p.payload.audio3k.num_samples)
 				dump("Improper audio packet:", &p, packet_size(p));
-			buffer_depth--;
 			packet->SetAudioSamples(p.payload.audio3k.samples, true);
 		}
 		else
@@ -142,17 +80,9 @@ void CDV3000::ProcessPacket(const SDV_Packet &p)
 			dump("ReadDevice() ERROR: Read an unexpected device packet:", &p, packet_size(p));
 			return;
 		}
-		if (Encoding::dstar == type)	// is this a DMR or a DStar device?
-		{
-			g_Cont.dstar_mux.lock();
+		if (Encoding::dstar == encoding)	// was this a DMR or a DStar channel?
 			g_Cont.RouteDstPacket(packet);
-			g_Cont.dstar_mux.unlock();
-		}
 		else
-		{
-			g_Cont.dmrst_mux.lock();
 			g_Cont.RouteDmrPacket(packet);
-			g_Cont.dmrst_mux.unlock();
-		}
 	}
 }
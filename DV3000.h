@@ -26,12 +26,7 @@ public:
 	virtual ~CDV3000();
 
 protected:
-	void PushWaitingPacket(unsigned int channel, std::shared_ptr<CTranscoderPacket> packet);
-	std::shared_ptr<CTranscoderPacket> PopWaitingPacket(unsigned int channel);
 	void ProcessPacket(const SDV_Packet &p);
-	bool SendAudio(const uint8_t channel, const int16_t *audio) const;
-	bool SendData(const uint8_t channel, const uint8_t *data) const;
-
-private:
-	CPacketQueue waiting_packet;	// the packet currently being processed in each vocoder
+	unsigned int FormatAudio(uint8_t *buf, const uint8_t channel, const int16_t *audio) const;
+	unsigned int FormatData(uint8_t *buf, const uint8_t channel, const uint8_t *data) const;
 };
@@ -33,6 +33,7 @@
 #include <thread>
 
 #include "DV3003.h"
+#include "DVSIFrame.h"
 #include "Configure.h"
 #include "Controller.h"
 
@@ -40,95 +41,30 @@ extern CController g_Cont;
 
 CDV3003::CDV3003(Encoding t) : CDVDevice(t) {}
 
-CDV3003::~CDV3003()
-{
-	for (int i=0; i<3; i++)
-		waiting_packet[i].Shutdown();
-}
-
-void CDV3003::PushWaitingPacket(unsigned int channel, std::shared_ptr<CTranscoderPacket> packet)
-{
-	waiting_packet[channel].push(packet);
-}
-
-std::shared_ptr<CTranscoderPacket> CDV3003::PopWaitingPacket(unsigned int channel)
-{
-	return waiting_packet[channel].pop();
-}
+CDV3003::~CDV3003() {}
 
-bool CDV3003::SendAudio(const uint8_t channel, const int16_t *audio) const
+unsigned int CDV3003::FormatAudio(uint8_t *buf, const uint8_t channel, const int16_t *audio) const
 {
-	// Create Audio packet based on input int8_ts
-	SDV_Packet p;
-	p.start_byte = PKT_HEADER;
-	p.header.payload_length = htons(1 + sizeof(p.payload.audio));
-	p.header.packet_type = PKT_SPEECH;
-	p.field_id = channel + PKT_CHANNEL0;
-	p.payload.audio.speechd = PKT_SPEECHD;
-	p.payload.audio.num_samples = 160U;
-	for (int i=0; i<160; i++)
-		p.payload.audio.samples[i] = htons(audio[i]);
-
-	// send audio packet to DV3000
-	const DWORD size = packet_size(p);
-	DWORD written;
-	auto status = FT_Write(ftHandle, &p, size, &written);
-	if (FT_OK != status)
-	{
-		FTDI_Error("Error writing audio packet", status);
-		return true;
-	}
-	else if (size != written)
-	{
-		std::cerr << "Incomplete Speech Packet write on " << description << std::endl;
-		return true;
-	}
-
-	return false;
+	return WriteSpeechFrame(buf, channel, audio);
 }
 
-bool CDV3003::SendData(const uint8_t channel, const uint8_t *data) const
+unsigned int CDV3003::FormatData(uint8_t *buf, const uint8_t channel, const uint8_t *data) const
 {
-	// Create data packet
-	SDV_Packet p;
-	p.start_byte = PKT_HEADER;
-	p.header.payload_length = htons(1 + sizeof(p.payload.ambe));
-	p.header.packet_type = PKT_CHANNEL;
-	p.field_id = channel + PKT_CHANNEL0;
-	p.payload.ambe.chand = PKT_CHAND;
-	p.payload.ambe.num_bits = 72U;
-	memcpy(p.payload.ambe.data, data, 9);
-
-	// send data packet to DV3000
-	const DWORD size = packet_size(p);
-	DWORD written;
-	auto status = FT_Write(ftHandle, &p, size, &written);
-	if (FT_OK != status)
-	{
-		FTDI_Error("Error writing AMBE Packet", status);
-		return true;
-	}
-	else if (size != written)
-	{
-		std::cerr << "Incomplete AMBE Packet write on " << description << std::endl;
-		return true;
-	}
-
-	return false;
+	return WriteChannelFrame(buf, channel, data);
 }
 
 void CDV3003::ProcessPacket(const SDV_Packet &p)
 {
 	unsigned int channel = p.field_id - PKT_CHANNEL0;
-	auto packet = PopWaitingPacket(channel);
+	Encoding encoding;
+	auto packet = PopWaitingPacket(channel, encoding);
 	if (packet)
 	{
 		if (PKT_CHANNEL == p.header.packet_type)
 		{
 			if (12!=ntohs(p.header.payload_length) || PKT_CHAND!=p.payload.ambe.chand || 72!=p.payload.ambe.num_bits)
 				dump("Improper ambe packet:", &p, packet_size(p));
-			buffer_depth--;
-			if (Encoding::dstar == type)
+			if (Encoding::dstar == encoding)
 				packet->SetDStarData(p.payload.ambe.data);
 			else
 				packet->SetDMRData(p.payload.ambe.data);
@@ -138,7 +74,6 @@ void CDV3003::ProcessPacket(const SDV_Packet &p)
 		{
 			if (323!=ntohs(p.header.payload_length) || PKT_SPEECHD!=p.payload.audio.speechd || 160!=p.payload.audio.num_samples)
 				dump("Improper audio packet:", &p, packet_size(p));
-			buffer_depth--;
 			packet->SetAudioSamples(p.payload.audio.samples, true);
 		}
 		else
@@ -146,17 +81,9 @@ void CDV3003::ProcessPacket(const SDV_Packet &p)
 			dump("ReadDevice() ERROR: Read an unexpected device packet:", &p, packet_size(p));
 			return;
 		}
-		if (Encoding::dstar == type)	// is this a DMR or a DStar device?
-		{
-			g_Cont.dstar_mux.lock();
+		if (Encoding::dstar == encoding)	// was this a DMR or a DStar channel?
 			g_Cont.RouteDstPacket(packet);
-			g_Cont.dstar_mux.unlock();
-		}
 		else
-		{
-			g_Cont.dmrst_mux.lock();
 			g_Cont.RouteDmrPacket(packet);
-			g_Cont.dmrst_mux.unlock();
-		}
 	}
 }
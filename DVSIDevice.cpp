@@ -32,36 +32,45 @@
 #include <iomanip>
 #include <cerrno>
 #include <thread>
+#include <algorithm>
+#include <pthread.h>
+#include <ctime>
 
 #include "DVSIDevice.h"
 #include "Configure.h"
 
 extern CConfigure g_Conf;
 
-CDVDevice::CDVDevice(Encoding t) : type(t), ftHandle(nullptr), buffer_depth(0), keep_running(true)
+CDVDevice::CDVDevice(Encoding t) : type(t), ftHandle(nullptr), keep_running(true), nchannels(0), depth(0)
 {
+	pthread_mutex_init(&rx_event.eMutex, nullptr);
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&rx_event.eCondVar, &attr);
+	pthread_condattr_destroy(&attr);
+	rx_event.iVar = 0;
 }
 
 CDVDevice::~CDVDevice()
 {
 	CloseDevice();
+	pthread_cond_destroy(&rx_event.eCondVar);
+	pthread_mutex_destroy(&rx_event.eMutex);
 }
 
 void CDVDevice::CloseDevice()
 {
-	input_queue.Shutdown();
+	feed_wakeup.Shutdown();
 	keep_running = false;
-	if (ftHandle)
-	{
-		auto status = FT_Close(ftHandle);
-		if (FT_OK != status)
-			FTDI_Error("FT_Close", status);
-	}
+	WakeReader();
 
 	if (feedFuture.valid())
 		feedFuture.get();
 	if (readFuture.valid())
 		readFuture.get();
+
+	ClosePort();
 }
 
 void CDVDevice::FTDI_Error(const char *where, FT_STATUS status) const
@@ -133,6 +142,13 @@ void CDVDevice::FTDI_Error(const char *where, FT_STATUS status) const
 	std::cerr << std::endl;
 }
 
+void CDVDevice::WakeReader()
+{
+	pthread_mutex_lock(&rx_event.eMutex);
+	pthread_cond_signal(&rx_event.eCondVar);
+	pthread_mutex_unlock(&rx_event.eMutex);
+}
+
 bool CDVDevice::checkResponse(SDV_Packet &p, uint8_t response) const
 {
 	if(p.start_byte != PKT_HEADER || p.header.packet_type != PKT_CONTROL || p.field_id != response)
@@ -141,7 +157,8 @@ bool CDVDevice::checkResponse(SDV_Packet &p, uint8_t response) const
 	return false;
 }
 
-bool CDVDevice::OpenDevice(const std::string &serialno, const std::string &desc, Edvtype dvtype, int8_t in_gain, int8_t out_gain)
+// opens and configures the FTDI chip in front of the vocoder
+bool CDVDevice::OpenPort(const std::string &serialno, Edvtype dvtype)
 {
 	auto status = FT_OpenEx((PVOID)serialno.c_str(), FT_OPEN_BY_SERIAL_NUMBER, &ftHandle);
 	if (FT_OK != status)
@@ -220,6 +237,14 @@ bool CDVDevice::OpenDevice(const std::string &serialno, const std::string &desc,
 		return true;
 	}
 
+	// the reader sleeps until the driver says there is something to read
+	status = FT_SetEventNotification(ftHandle, FT_EVENT_RXCHAR, (PVOID)&rx_event);
+	if (status != FT_OK)
+	{
+		FTDI_Error("FT_SetEventNotification", status);
+		return true;
+	}
+
 	// NO TIMEOUTS! We are using blocking I/O!!!
 	// status = FT_SetTimeouts(ftHandle, 200, 200 );
 	// if (status != FT_OK)
@@ -228,11 +253,41 @@ bool CDVDevice::OpenDevice(const std::string &serialno, const std::string &desc,
 	// 	return false;
 	// }
 
+	std::cout << "Opened " << description << " at " << baudrate << " baud with a " << maxsize << " byte max transfer size" << std::endl;
+	return false;
+}
+
+void CDVDevice::ClosePort()
+{
+	if (ftHandle)
+	{
+		auto status = FT_Close(ftHandle);
+		if (FT_OK != status)
+			FTDI_Error("FT_Close", status);
+		ftHandle = nullptr;
+	}
+}
+
+FT_STATUS CDVDevice::WritePort(const void *buf, DWORD size, DWORD &written)
+{
+	return FT_Write(ftHandle, const_cast<void *>(buf), size, &written);
+}
+
+FT_STATUS CDVDevice::ReadPort(void *buf, DWORD size, DWORD &bytes_read)
+{
+	return FT_Read(ftHandle, buf, size, &bytes_read);
+}
+
+bool CDVDevice::OpenDevice(const std::string &serialno, const std::string &desc, Edvtype dvtype, int8_t in_gain, int8_t out_gain)
+{
 	description.assign(desc);
 	description.append(" ");
 	description.append(serialno);
+	nchannels = (Edvtype::dv3000 == dvtype) ? 1 : 3;
+	depth = g_Conf.GetChannelDepth();
 
-	std::cout << "Opened " << description << " at " << baudrate << " baud with a " << maxsize << " byte max transfer size" << std::endl;
+	if (OpenPort(serialno, dvtype))
+		return true;
 
 	if (InitDevice())
 		return true;
@@ -258,7 +313,7 @@ bool CDVDevice::InitDevice()
 	ctrlPacket.payload.ctrl.data.paritymode[0] = PKT_PARITYBYTE;
 	ctrlPacket.payload.ctrl.data.paritymode[1] = 0x3U ^ PKT_RESET ^ PKT_PARITYBYTE;
 	DWORD written = 0;
-	auto status = FT_Write(ftHandle, &ctrlPacket, 7, &written);
+	auto status = WritePort(&ctrlPacket, 7, written);
 	if (FT_OK != status)
 	{
 		FTDI_Error("Error writing soft reset packet", status);
@@ -292,7 +347,7 @@ bool CDVDevice::InitDevice()
 	ctrlPacket.payload.ctrl.data.paritymode[0] = 0;
 	ctrlPacket.payload.ctrl.data.paritymode[1] = PKT_PARITYBYTE;
 	ctrlPacket.payload.ctrl.data.paritymode[2] = 0x4U ^ PKT_PARITYMODE ^ PKT_PARITYBYTE;
-	status = FT_Write(ftHandle, &ctrlPacket, 8, &written);
+	status = WritePort(&ctrlPacket, 8, written);
 	if (FT_OK != status)
 	{
 		FTDI_Error("Error writing parity control packet: ", status);
@@ -325,7 +380,7 @@ bool CDVDevice::InitDevice()
 	ctrlPacket.header.packet_type = PKT_CONTROL;
 	ctrlPacket.field_id = PKT_PRODID;
 
-	status = FT_Write(ftHandle, &ctrlPacket, 5, &written);
+	status = WritePort(&ctrlPacket, 5, written);
 	if (FT_OK != status)
 	{
 		FTDI_Error("Error writing Product ID packet", status);
@@ -352,7 +407,7 @@ bool CDVDevice::InitDevice()
 	productid.assign(responsePacket.payload.ctrl.data.prodid);
 
 	ctrlPacket.field_id = PKT_VERSTRING;
-	status = FT_Write(ftHandle, &ctrlPacket, 5, &written);
+	status = WritePort(&ctrlPacket, 5, written);
 	if (FT_OK != status)
 	{
 		FTDI_Error("Error writing Version packet", status);
@@ -388,9 +443,10 @@ void CDVDevice::Start()
 	readFuture = std::async(std::launch::async, &CDVDevice::ReadDevice, this);
 }
 
-bool CDVDevice::ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain, int8_t out_gain)
+// writes the codec configuration packet for a channel into buf and returns its size
+unsigned int CDVDevice::FormatConfig(uint8_t *buf, uint8_t pkt_ch, Encoding type, int8_t in_gain, int8_t out_gain) const
 {
-	SDV_Packet controlPacket, responsePacket;
+	SDV_Packet controlPacket;
 	const uint8_t ecmode[] { PKT_ECMODE, 0x0, 0x0 };
 	const uint8_t dcmode[] { PKT_DCMODE, 0x0, 0x0 };
 	const uint8_t  dstar[] { PKT_RATEP, 0x01U, 0x30U, 0x07U, 0x63U, 0x40U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x00U, 0x48U };
@@ -399,8 +455,6 @@ bool CDVDevice::ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain,
 	const uint8_t  spfmt[] { PKT_SPCHFMT, 0x0, 0x0 };
 	const uint8_t   gain[] { PKT_GAIN, uint8_t(in_gain), uint8_t(out_gain) };
 	const uint8_t   init[] { PKT_INIT, 0x3U };
-	const uint8_t   resp[] { 0x0, PKT_ECMODE, 0x0, PKT_DCMODE, 0x0, PKT_RATEP, 0x0, PKT_CHANFMT, 0x0, PKT_SPCHFMT, 0x0, PKT_GAIN, 0x0, PKT_INIT, 0x0 };
-
 
 	controlPacket.start_byte = PKT_HEADER;
 	controlPacket.header.payload_length = htons(1 + sizeof(SDV_Packet::payload.codec));
@@ -421,10 +475,27 @@ bool CDVDevice::ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain,
 	memcpy(controlPacket.payload.codec.gain, gain, 3);
 	memcpy(controlPacket.payload.codec.init, init, 2);
 
+	const unsigned int size = packet_size(controlPacket);
+	memcpy(buf, &controlPacket, size);
+	return size;
+}
+
+// every field of the configuration has to be accepted
+bool CDVDevice::ConfigResponseFailed(const SDV_Packet &p, uint8_t pkt_ch) const
+{
+	const uint8_t resp[] { 0x0, PKT_ECMODE, 0x0, PKT_DCMODE, 0x0, PKT_RATEP, 0x0, PKT_CHANFMT, 0x0, PKT_SPCHFMT, 0x0, PKT_GAIN, 0x0, PKT_INIT, 0x0 };
+	return (ntohs(p.header.payload_length) != 16) || (p.field_id != pkt_ch) || (0 != memcmp(p.payload.ctrl.data.resp, resp, sizeof(resp)));
+}
+
+bool CDVDevice::ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain, int8_t out_gain)
+{
+	SDV_Packet responsePacket;
+	uint8_t buf[sizeof(SDV_Packet)];
+
 	// write packet
 	DWORD written;
-	const DWORD size = packet_size(controlPacket);
-	auto status = FT_Write(ftHandle, &controlPacket, size, &written);
+	const DWORD size = FormatConfig(buf, pkt_ch, type, in_gain, out_gain);
+	auto status = WritePort(buf, size, written);
 	if (FT_OK != status)
 	{
 		FTDI_Error("error writing codec config packet", status);
@@ -442,81 +513,132 @@ bool CDVDevice::ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain,
 		return true;
 	}
 
-	if ((ntohs(responsePacket.header.payload_length) != 16) || (responsePacket.field_id != pkt_ch) || (0 != memcmp(responsePacket.payload.ctrl.data.resp, resp, sizeof(resp))))
+	if (ConfigResponseFailed(responsePacket, pkt_ch))
 	{
 		std::cerr << "Config response packet failed" << std::endl;
 		dump("Configuration Response Packet:", &responsePacket, packet_size(responsePacket));
 		return true;
 	};
 
+	auto &c = chan[pkt_ch - PKT_CHANNEL0];
+	c.encoding = type;
+	c.in_gain = in_gain;
+	c.out_gain = out_gain;
 	std::cout << description << " channel " << (unsigned int)(pkt_ch - PKT_CHANNEL0) << " is now configured for " << ((Encoding::dstar == type) ? "D-Star" : "DMR/YSF") << std::endl;
 
 	return false;
 }
 
-bool CDVDevice::GetResponse(SDV_Packet &packet)
+void CDVDevice::Reconfigure(unsigned int channel, Encoding type, int8_t in_gain, int8_t out_gain)
 {
-	FT_STATUS status;
-	DWORD bytes_read;
-
-	// get the start byte
-	for (unsigned i = 0U; i < USB3XXX_MAXPACKETSIZE+2; ++i) {
-		status = FT_Read(ftHandle, &packet.start_byte, 1, &bytes_read);
-		if (FT_OK != status)
-		{
-			FTDI_Error("Reading packet start byte", status);
-			return true;
-		}
+	if (channel >= nchannels || EConfig::idle != chan[channel].config)
+	{
+		std::cerr << "Channel " << channel << " on " << description << " can't be reconfigured now" << std::endl;
+		return;
+	}
+	auto &c = chan[channel];
+	c.new_encoding = type;
+	c.in_gain = in_gain;
+	c.out_gain = out_gain;
+	c.config_start = std::chrono::steady_clock::now();
+	c.config = EConfig::requested;
+	feed_wakeup.Notify();
+}
 
-		if (packet.start_byte == PKT_HEADER)
-			break;
+// the read thread calls this with the device's answer to a runtime reconfiguration
+void CDVDevice::ConfigDone(const SDV_Packet &p)
+{
+	const unsigned int channel = p.field_id - PKT_CHANNEL0;
+	if (channel >= nchannels || EConfig::sent != chan[channel].config)
+	{
+		dump("ReadDevice() ERROR: Read an unexpected control packet:", &p, packet_size(p));
+		return;
 	}
 
-	if (packet.start_byte != PKT_HEADER) {
-		std::cerr << "Couldn't find start byte!" << std::endl;
-		return true;
+	auto &c = chan[channel];
+	const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - c.config_start).count();
+	if (ConfigResponseFailed(p, p.field_id))
+	{
+		c.reconfig_failures++;
+		std::cerr << description << " channel " << channel << " couldn't be reconfigured" << std::endl;
+		dump("Configuration Response Packet:", &p, packet_size(p));
+	}
+	else if (c.new_encoding != c.encoding)
+	{
+		c.encoding = c.new_encoding;
+		c.reconfigs++;
+		c.reconfig_total += us;
+		if (us > c.reconfig_max)
+			c.reconfig_max = us;
+		std::cout << description << " channel " << channel << " switched to " << ((Encoding::dstar == c.new_encoding) ? "D-Star" : "DMR/YSF") << " in " << us << " us" << std::endl;
 	}
 
-	// get the packet size and type (three bytes)
-	DWORD bytesLeft = sizeof(packet.header);
-	while (bytesLeft > 0) {
-		status = FT_Read(ftHandle, &packet.header, sizeof(packet.header), &bytes_read);
-		if (FT_OK != status)
+	if (c.resync)
+	{
+		// the device answers in order, so anything still waiting was answered before this,
+		// and those answers were thrown away
+		SInFlight f;
+		unsigned int dropped = 0;
+		if (c.has_oldest)
 		{
-			FTDI_Error("Error reading response packet header", status);
-			return true;
+			c.oldest.packet.reset();
+			c.has_oldest = false;
+			dropped++;
 		}
-		bytesLeft -= bytes_read;
-	}
+		while (c.waiting.try_pop(f))
+			dropped++;
+		c.timeouts += dropped;
+		c.in_flight -= dropped;
+		c.resync = false;
+		std::cout << description << " channel " << channel << " was resynced in " << us << " us, " << dropped << " frames were dropped" << std::endl;
+	}
+	c.config = EConfig::idle;
+	feed_wakeup.Notify();
+}
 
-	bytesLeft = ntohs(packet.header.payload_length);
-    if (bytesLeft > 1 + int(sizeof(packet.payload))) {
-        std::cout << "AMBEserver: Serial payload exceeds buffer size: " << int(bytesLeft) << std::endl;
-        return true;
-    }
+// the device only sends control responses when it's asked, one at a time, so this
+// blocks for exactly the bytes the next packet still needs and never reads past it
+bool CDVDevice::GetResponse(SDV_Packet &packet)
+{
+	const auto discarded = parser.Discarded();
+	const SDV_Packet *p;
+	while (nullptr == (p = parser.Next()))
+	{
+		if (parser.Discarded() - discarded > USB3XXX_MAXPACKETSIZE)
+		{
+			std::cerr << "Couldn't find start byte!" << std::endl;
+			return true;
+		}
 
-    while (bytesLeft > 0) {
-		status = FT_Read(ftHandle, &packet.field_id, bytesLeft, &bytes_read);
+		std::size_t room;
+		auto buf = parser.Space(room);
+		DWORD bytes_read = 0;
+		auto status = ReadPort(buf, DWORD(std::min(parser.Needed(), room)), bytes_read);
 		if (FT_OK != status)
 		{
-			FTDI_Error("Error reading packet payload", status);
+			FTDI_Error("Error reading response packet", status);
 			return true;
 		}
+		if (0 == bytes_read)
+		{
+			std::cerr << "Nothing to read from " << description << std::endl;
+			return true;
+		}
+		parser.Commit(bytes_read);
+	}
 
-        bytesLeft -= bytes_read;
-    }
-
-    return false;
+	memcpy(&packet, p, packet_size(*p));
+	return false;
 }
 
-void CDVDevice::AddPacket(const std::shared_ptr<CTranscoderPacket> packet)
+void CDVDevice::AddPacket(const std::shared_ptr<CTranscoderPacket> packet, unsigned int channel)
 {
-	auto size = input_queue.push(packet);
-	if (size > 200)
-	{
-		std::cerr << ((type==Encoding::dstar) ? "DStar" : "DMR/YSF") << " inQ size is overflowing! Shutting down..." << std::endl;
-		raise(SIGINT);
-	}
+	if (channel >= nchannels)
+		std::cerr << "Channel " << channel << " doesn't exist on " << description << std::endl;
+	else if (EQueueStatus::full == chan[channel].pending.push(packet))
+		std::cerr << "Channel " << channel << " on " << description << " isn't keeping up, dropped a packet" << std::endl;
+	else
+		feed_wakeup.Notify();
 }
 
 void CDVDevice::dump(const char *title, const void *pointer, int length) const
@@ -564,79 +686,226 @@ void CDVDevice::dump(const char *title, const void *pointer, int length) const
 
 void CDVDevice::FeedDevice()
 {
-	const std::string modules(g_Conf.GetTCMods());
-	const auto n = modules.size();
 	while (keep_running)
 	{
-		auto packet = input_queue.pop();	// blocks until there is something to pop, unless shutting down
+		std::shared_ptr<CTranscoderPacket> packet;
 
-		if (packet)
+		// every channel with a free credit and a pending packet gets a frame in this write
+		DWORD size = 0;
+		const auto now = std::chrono::steady_clock::now();
+		for (unsigned int ch=0; ch<nchannels; ch++)
 		{
-			while (keep_running)	// wait until there is room
+			auto &c = chan[ch];
+			const auto config = c.config.load();
+			if (EConfig::sent == config)
+				continue;
+			if (EConfig::requested == config && (c.resync || (0 == c.in_flight && c.pending.IsEmpty())))
 			{
-				if (buffer_depth < 2)
-					break;
-
-				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				// the channel is drained, or it's being resynced and nothing more goes to it until
+				// this is answered, so the new configuration can go out with the frames
+				size += FormatConfig(txbuf + size, uint8_t(PKT_CHANNEL0 + ch), c.new_encoding, c.in_gain, c.out_gain);
+				c.config = EConfig::sent;
+				continue;
 			}
-
-			if (keep_running)
+			const Encoding encoding = c.encoding;
+			while (c.in_flight < depth && c.pending.try_pop(packet))
 			{
-				auto index = modules.find(packet->GetModule());
-				// save the packet in the vocoder's queue while the vocoder does its magic
-				if (std::string::npos == index)
-				{
-					std::cerr << "Module '" << packet->GetModule() << "' is not configured on " << description << std::endl;
-				}
+				const bool needs_audio = (Encoding::dstar==encoding) ? packet->DStarIsSet() : packet->DMRIsSet();
+				if (needs_audio)
+					size += FormatData(txbuf + size, ch, (Encoding::dstar==encoding) ? packet->GetDStarData() : packet->GetDMRData());
 				else
-				{
-					PushWaitingPacket(index, packet);
-
-					const bool needs_audio = (Encoding::dstar==type) ? packet->DStarIsSet() : packet->DMRIsSet();
-
-					if (needs_audio)
-					{
-						SendData(index, (Encoding::dstar==type) ? packet->GetDStarData() : packet->GetDMRData());
-					}
-					else
-					{
-						SendAudio(index, packet->GetAudioSamples());
-					}
-					buffer_depth++;
-				}
+					size += FormatAudio(txbuf + size, ch, packet->GetAudioSamples());
+				// save the packet in the vocoder's queue while the vocoder does its magic
+				c.in_flight++;
+				c.waiting.push(SInFlight { packet, now, encoding });
 			}
 		}
+
+		if (size)
+		{
+			DWORD written;
+			auto status = WritePort(txbuf, size, written);
+			if (FT_OK != status)
+				FTDI_Error("Error writing frames", status);
+			else if (size != written)
+				std::cerr << "Incomplete write of " << written << " of " << size << " bytes on " << description << std::endl;
+			continue;
+		}
+
+		// there's nothing that can be written now, so wait for a new packet, or for
+		// a channel to give a credit back
+		feed_wakeup.pop();
+	}
+}
+
+// the vocoder has returned a frame on this channel, so this frees a credit
+// a channel that's being resynced returns nothing, its answers can't be matched to frames
+std::shared_ptr<CTranscoderPacket> CDVDevice::PopWaitingPacket(unsigned int channel, Encoding &encoding)
+{
+	SInFlight f;
+	if (channel < nchannels && chan[channel].resync)
+		return nullptr;
+	if (channel < nchannels && chan[channel].has_oldest)
+	{
+		f = std::move(chan[channel].oldest);
+		chan[channel].has_oldest = false;
+	}
+	else if (channel >= nchannels || ! chan[channel].waiting.try_pop(f))
+	{
+		std::cerr << "There is no packet waiting for channel " << channel << " on " << description << std::endl;
+		return nullptr;
+	}
+
+	auto &c = chan[channel];
+	const uint64_t us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - f.sent).count();
+	c.frames++;
+	c.rtt_total += us;
+	if (us > c.rtt_max)
+		c.rtt_max = us;
+	c.in_flight--;
+	feed_wakeup.Notify();
+
+	encoding = f.encoding;
+	return f.packet;
+}
+
+// the read thread calls this. a response that the device dropped, or that was too damaged
+// to parse, would keep its frame's credit forever, and once a channel has lost all of them
+// it can't be fed or reconfigured. so a frame that's been gone for much longer than the
+// channel's round trip is given up on. but it might only be late, and answers have no tag,
+// so if it did come back, it and every answer after it would go to the wrong packet. so
+// the channel is resynced: it isn't fed, its configuration is sent again, and its answers
+// are thrown away until that's answered. then every frame that was waiting is dropped and
+// its credit comes back, see ConfigDone()
+void CDVDevice::ExpireWaiting()
+{
+	const auto now = std::chrono::steady_clock::now();
+	for (unsigned int ch=0; ch<nchannels; ch++)
+	{
+		auto &c = chan[ch];
+		if (0 == c.in_flight || c.resync)
+			continue;
+		if (! c.has_oldest)
+		{
+			if (! c.waiting.try_pop(c.oldest))
+				continue;
+			c.has_oldest = true;
+		}
+		const uint64_t frames = c.frames;
+		const auto timeout = std::max<std::chrono::steady_clock::duration>(min_timeout, std::chrono::microseconds(frames ? timeout_rtts * c.rtt_total / frames : 0));
+		if (now - c.oldest.sent < timeout)
+			continue;
+
+		c.resyncs++;
+		c.resync = true;
+		// a reconfiguration that's waiting for the channel to drain does the resync too
+		if (EConfig::idle == c.config)
+		{
+			c.new_encoding = c.encoding;
+			c.config_start = now;
+			c.config = EConfig::requested;
+		}
+		std::cerr << description << " channel " << ch << " lost a frame, resyncing" << std::endl;
+		feed_wakeup.Notify();
+	}
+}
+
+void CDVDevice::ReportStats() const
+{
+	for (unsigned int ch=0; ch<nchannels; ch++)
+	{
+		const auto &c = chan[ch];
+		std::cout << description << " channel " << ch << ": " << c.frames << " frames, " << c.in_flight << " in flight";
+		if (c.frames)
+			std::cout << ", round trip average " << c.rtt_total / c.frames << " us, maximum " << c.rtt_max << " us";
+		if (c.reconfigs)
+			std::cout << ", " << c.reconfigs << " reconfigurations, average " << c.reconfig_total / c.reconfigs << " us, maximum " << c.reconfig_max << " us";
+		if (c.reconfig_failures)
+			std::cout << ", " << c.reconfig_failures << " failed reconfigurations";
+		if (c.timeouts)
+			std::cout << ", " << c.timeouts << " frames timed out";
+		if (c.resyncs)
+			std::cout << ", " << c.resyncs << " resyncs";
+		std::cout << std::endl;
+	}
+	std::cout << description << ": " << responses << " packets in " << reads << " reads, " << parser.Discarded() << " bytes discarded" << std::endl;
+}
+
+CDVDevice::SChannelStats CDVDevice::GetChannelStats(unsigned int channel) const
+{
+	const auto &c = chan[channel];
+	return SChannelStats { c.encoding, c.in_flight, c.pending.Size(), c.frames, c.rtt_total, c.rtt_max, c.reconfigs, c.reconfig_failures, c.timeouts, c.resyncs };
+}
+
+// waits for the driver to say there is something to read, returns true on failure
+// count is how many bytes can be read without blocking, it's 0 if the wait timed out.
+// the wait is short because a character that arrives between FT_GetQueueStatus()
+// and the wait doesn't signal the event again
+bool CDVDevice::WaitForRx(DWORD &count)
+{
+	auto status = FT_GetQueueStatus(ftHandle, &count);
+	if (FT_OK == status && 0 == count)
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_nsec += 10000000;	// 10 ms
+		if (ts.tv_nsec >= 1000000000)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+		pthread_mutex_lock(&rx_event.eMutex);
+		if (keep_running)
+			pthread_cond_timedwait(&rx_event.eCondVar, &rx_event.eMutex, &ts);
+		pthread_mutex_unlock(&rx_event.eMutex);
+		status = FT_GetQueueStatus(ftHandle, &count);
 	}
+	if (FT_OK != status)
+	{
+		FTDI_Error("FT_GetQueueStatus", status);
+		return true;
+	}
+	return false;
 }
 
 void CDVDevice::ReadDevice()
 {
 	while (keep_running)
 	{
-		// wait for something to read...
-		DWORD RxBytes = 0;
-		while (0 == RxBytes)
+		DWORD count;
+		if (WaitForRx(count))
 		{
-			auto status = FT_GetQueueStatus(ftHandle, &RxBytes);
-			if (FT_OK != status)
-			{
-				FTDI_Error("FT_GetQueueStatus", status);
-				std::cerr << "Shutting down..." << std::endl;
-				raise(SIGTERM);
-			}
-
-			if (0 == RxBytes)
-			{
-				std::this_thread::sleep_for(std::chrono::milliseconds(3));
-				if (! keep_running)
-					return;
-			}
+			std::cerr << "Shutting down..." << std::endl;
+			raise(SIGTERM);
+			return;
 		}
+		ExpireWaiting();
+		if (0 == count)
+			continue;
+
+		// read everything that's there, and then process every whole packet in it
+		std::size_t room;
+		auto buf = parser.Space(room);
+		DWORD bytes_read = 0;
+		auto status = ReadPort(buf, DWORD(std::min(std::size_t(count), room)), bytes_read);
+		if (FT_OK != status)
+		{
+			FTDI_Error("FT_Read", status);
+			std::cerr << "Shutting down..." << std::endl;
+			raise(SIGTERM);
+			return;
+		}
+		reads++;
+		parser.Commit(bytes_read);
 
-		SDV_Packet p;
-		if (! GetResponse(p))
+		const SDV_Packet *p;
+		while (nullptr != (p = parser.Next()))
 		{
-			ProcessPacket(p);
+			responses++;
+			if (PKT_CONTROL == p->header.packet_type)
+				ConfigDone(*p);
+			else
+				ProcessPacket(*p);
 		}
 	}
 }
@@ -21,10 +21,12 @@
 #include <sstream>
 #include <future>
 #include <atomic>
+#include <chrono>
 #include <ftd2xx.h>
 
 #include "PacketQueue.h"
 #include "DVSIPacket.h"
+#include "DVSIParser.h"
 
 class CDVDevice
 {
@@ -35,32 +37,117 @@ public:
 	bool OpenDevice(const std::string &serialno, const std::string &desc, Edvtype dvtype, int8_t in_gain, int8_t out_gain);
 	void Start();
 	void CloseDevice();
-	void AddPacket(const std::shared_ptr<CTranscoderPacket> packet);
+	void AddPacket(const std::shared_ptr<CTranscoderPacket> packet, unsigned int channel);
+	unsigned int GetChannels() const { return nchannels; }
+	const std::string &GetDescription() const { return description; }
 	std::string GetProductID() { return productid; }
+	Encoding GetEncoding(unsigned int channel) const { return chan[channel].encoding; }
+	// switches a channel to the other encoding at runtime. the feed thread sends the new
+	// configuration once the channel has nothing in flight, and the read thread checks
+	// the response. the channel can't be used until IsReconfiguring() is false. if
+	// the device rejects the new configuration, the channel keeps its old encoding
+	void Reconfigure(unsigned int channel, Encoding type, int8_t in_gain, int8_t out_gain);
+	bool IsReconfiguring(unsigned int channel) const { return EConfig::idle != chan[channel].config; }
+	virtual void ReportStats() const;
+
+	// a snapshot of a channel, for the metrics, any thread can take one
+	struct SChannelStats
+	{
+		Encoding encoding;
+		unsigned int in_flight;
+		std::size_t pending;
+		uint64_t frames, rtt_total, rtt_max, reconfigs, reconfig_failures, timeouts, resyncs;	// times are in microseconds
+	};
+	SChannelStats GetChannelStats(unsigned int channel) const;
+	unsigned int GetDepth() const { return depth; }
+	uint64_t GetResponses() const { return responses; }
+	uint64_t GetReads() const { return reads; }
 
 protected:
+	// a packet that has been written to a channel, and when it was written
+	struct SInFlight
+	{
+		std::shared_ptr<CTranscoderPacket> packet;
+		std::chrono::steady_clock::time_point sent;
+		Encoding encoding;	// the channel's encoding when it was written
+	};
+
+	enum class EConfig { idle, requested, sent };
+
+	// each vocoder channel gets depth credits. a credit is used when a frame is written to
+	// the channel and it comes back when the channel returns the processed frame, or when
+	// the frame has been given up on and the channel resynced, see ExpireWaiting()
+	struct SChannel
+	{
+		std::atomic<unsigned int> in_flight { 0 };
+		CRingQueue<SInFlight, 2 * MAX_CHANNEL_DEPTH> waiting;	// the packets the vocoder is working on, oldest first
+		// the read thread's look at the oldest waiting packet, it's taken off the front of waiting
+		// to check its age, and kept here until it comes back or is given up on
+		SInFlight oldest;
+		bool has_oldest = false;
+		std::atomic<uint64_t> timeouts { 0 };	// frames that were given up on
+		// answers are matched to frames in order, so after a timeout the channel isn't fed
+		// again until its configuration has been sent again and answered. every answer before
+		// that is thrown away, see ExpireWaiting()
+		std::atomic<bool> resync { false };
+		std::atomic<uint64_t> resyncs { 0 };
+		CPacketQueue pending;	// packets waiting for a credit, only the feed thread pops these
+		// round-trip statistics, only the read thread writes these
+		std::atomic<uint64_t> frames { 0 }, rtt_total { 0 }, rtt_max { 0 };	// times are in microseconds
+		std::atomic<Encoding> encoding { Encoding::dstar };
+		// a runtime reconfiguration. Reconfigure() sets the rest before it sets config
+		std::atomic<EConfig> config { EConfig::idle };
+		Encoding new_encoding;
+		int8_t in_gain, out_gain;	// the gains of the configuration, or of the one that's been requested
+		std::chrono::steady_clock::time_point config_start;
+		std::atomic<uint64_t> reconfigs { 0 }, reconfig_failures { 0 }, reconfig_total { 0 }, reconfig_max { 0 };	// also microseconds
+	};
+
 	const Encoding type;
 	FT_HANDLE ftHandle;
-	std::atomic<unsigned int> buffer_depth;
 	std::atomic<bool> keep_running;
-	CPacketQueue input_queue;
+	CRingQueue<bool, 2> feed_wakeup;	// the feeder waits on this for a new packet or a free credit
 	std::future<void> feedFuture, readFuture;
 	std::string description, productid;
+	unsigned int nchannels, depth;
+	SChannel chan[3];
+	// a frame is given up on after this many average round trips, but never sooner than min_timeout
+	static constexpr unsigned int timeout_rtts = 8;
+	static constexpr std::chrono::milliseconds min_timeout { 200 };
+	// room for a full set of frames for every channel, so it all goes in one write
+	alignas(64) uint8_t txbuf[3 * MAX_CHANNEL_DEPTH * sizeof(SDV_Packet)];
+	// the receive side, only the read thread uses these once the device is started
+	CDVSIParser parser;
+	EVENT_HANDLE rx_event;
+	std::atomic<uint64_t> reads { 0 }, responses { 0 };
 
 	bool DiscoverFtdiDevices();
 	bool ConfigureVocoder(uint8_t pkt_ch, Encoding type, int8_t in_gain, int8_t out_gain);
+	unsigned int FormatConfig(uint8_t *buf, uint8_t pkt_ch, Encoding type, int8_t in_gain, int8_t out_gain) const;
+	bool ConfigResponseFailed(const SDV_Packet &p, uint8_t pkt_ch) const;
+	void ConfigDone(const SDV_Packet &p);
 	bool checkResponse(SDV_Packet &responsePacket, uint8_t response) const;
 	bool GetResponse(SDV_Packet &packet);
 	bool InitDevice();
 	void FeedDevice();
 	void ReadDevice();
+	std::shared_ptr<CTranscoderPacket> PopWaitingPacket(unsigned int channel, Encoding &encoding);
+	void ExpireWaiting();
 	void FTDI_Error(const char *where, FT_STATUS status) const;
 	void dump(const char *title, const void *data, int length) const;
 
+	// the port to the vocoder. these are an FTDI USB serial port, unless a
+	// stand-in device replaces them
+	virtual bool OpenPort(const std::string &serialno, Edvtype dvtype);
+	virtual void ClosePort();
+	virtual FT_STATUS WritePort(const void *buf, DWORD size, DWORD &written);
+	virtual FT_STATUS ReadPort(void *buf, DWORD size, DWORD &bytes_read);
+	virtual bool WaitForRx(DWORD &count);
+	virtual void WakeReader();
+
 	// pure virtual methods unique to the device type
-	virtual void PushWaitingPacket(unsigned int channel, std::shared_ptr<CTranscoderPacket> packet) = 0;
-	virtual std::shared_ptr<CTranscoderPacket> PopWaitingPacket(unsigned int channel) = 0;
 	virtual void ProcessPacket(const SDV_Packet &p) = 0;
-	virtual bool SendAudio(const uint8_t channel, const int16_t *audio) const = 0;
-	virtual bool SendData(const uint8_t channel, const uint8_t *data) const = 0;
+	// these format a frame into buf and return its size
+	virtual unsigned int FormatAudio(uint8_t *buf, const uint8_t channel, const int16_t *audio) const = 0;
+	virtual unsigned int FormatData(uint8_t *buf, const uint8_t channel, const uint8_t *data) const = 0;
 };
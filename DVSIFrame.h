@@ -0,0 +1,78 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <cstring>
+
+#include "DVSIPacket.h"
+#include "ByteSwap.h"
+
+// DVSI speech and channel frames, written straight into the transmit buffer and read
+// straight out of the receive buffer, without building an SDV_Packet on the stack.
+// the DV3000 frames don't have a channel, the DV3003 frames do
+
+// the frame sizes, including the four byte header
+constexpr unsigned int speech3k_size  = 4 + 1 + sizeof(SDV_Packet::payload.audio3k);
+constexpr unsigned int speech_size    = 4 + 1 + sizeof(SDV_Packet::payload.audio);
+constexpr unsigned int channel3k_size = 4 + 1 + sizeof(SDV_Packet::payload.ambe3k);
+constexpr unsigned int channel_size   = 4 + 1 + sizeof(SDV_Packet::payload.ambe);
+
+inline void WriteFrameHeader(uint8_t *buf, unsigned int size, uint8_t type, uint8_t field_id)
+{
+	const unsigned int length = size - 4;
+	buf[0] = PKT_HEADER;
+	buf[1] = uint8_t(length >> 8);
+	buf[2] = uint8_t(length);
+	buf[3] = type;
+	buf[4] = field_id;
+}
+
+// each of these return the size of the frame
+inline unsigned int WriteSpeech3kFrame(uint8_t *buf, const int16_t *audio)
+{
+	WriteFrameHeader(buf, speech3k_size, PKT_SPEECH, PKT_SPEECHD);
+	buf[5] = 160U;
+	SwapBytes16(buf + 6, audio, 160);
+	return speech3k_size;
+}
+
+inline unsigned int WriteSpeechFrame(uint8_t *buf, uint8_t channel, const int16_t *audio)
+{
+	WriteFrameHeader(buf, speech_size, PKT_SPEECH, PKT_CHANNEL0 + channel);
+	buf[5] = PKT_SPEECHD;
+	buf[6] = 160U;
+	SwapBytes16(buf + 7, audio, 160);
+	return speech_size;
+}
+
+inline unsigned int WriteChannel3kFrame(uint8_t *buf, const uint8_t *data)
+{
+	WriteFrameHeader(buf, channel3k_size, PKT_CHANNEL, PKT_CHAND);
+	buf[5] = 72U;
+	memcpy(buf + 6, data, 9);
+	return channel3k_size;
+}
+
+inline unsigned int WriteChannelFrame(uint8_t *buf, uint8_t channel, const uint8_t *data)
+{
+	WriteFrameHeader(buf, channel_size, PKT_CHANNEL, PKT_CHANNEL0 + channel);
+	buf[5] = PKT_CHAND;
+	buf[6] = 72U;
+	memcpy(buf + 7, data, 9);
+	return channel_size;
+}
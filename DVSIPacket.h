@@ -19,6 +19,7 @@
 #include <cstdint>
 
 #define USB3XXX_MAXPACKETSIZE   1024        // must be multiple of 64
+#define MAX_CHANNEL_DEPTH       4           // the most frames in flight on one vocoder channel
 
 #define PKT_HEADER              0x61
 
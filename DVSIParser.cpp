@@ -0,0 +1,100 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstring>
+
+#include "DVSIParser.h"
+
+CDVSIParser::CDVSIParser()
+{
+	Reset();
+}
+
+void CDVSIParser::Reset()
+{
+	head = tail = discarded = 0;
+}
+
+uint8_t *CDVSIParser::Space(std::size_t &room)
+{
+	if (head == tail)
+	{
+		head = tail = 0;
+	}
+	else if (head && sizeof(buffer) - tail < USB3XXX_MAXPACKETSIZE)
+	{
+		// there is only a partial packet left, so this never moves more than max_packet bytes
+		memmove(buffer, buffer + head, tail - head);
+		tail -= head;
+		head = 0;
+	}
+	room = sizeof(buffer) - tail;
+	return buffer + tail;
+}
+
+void CDVSIParser::Commit(std::size_t count)
+{
+	tail += count;
+	if (tail > sizeof(buffer))
+		tail = sizeof(buffer);
+}
+
+// moves head to something that could be the start of a packet
+// returns true if there aren't enough bytes to tell yet
+bool CDVSIParser::Resync()
+{
+	while (head < tail)
+	{
+		if (PKT_HEADER == buffer[head])
+		{
+			if (tail - head < header_size)
+				return true;
+			const std::size_t length = (std::size_t(buffer[head+1]) << 8) | buffer[head+2];
+			if (length > 0 && header_size + length <= max_packet)
+				return false;
+		}
+		head++;
+		discarded++;
+	}
+	return true;
+}
+
+const SDV_Packet *CDVSIParser::Next()
+{
+	if (Resync())
+		return nullptr;
+
+	const std::size_t size = header_size + ((std::size_t(buffer[head+1]) << 8) | buffer[head+2]);
+	if (tail - head < size)
+		return nullptr;
+
+	auto p = reinterpret_cast<const SDV_Packet *>(buffer + head);
+	head += size;
+	return p;
+}
+
+std::size_t CDVSIParser::Needed() const
+{
+	const std::size_t have = tail - head;
+	if (have < header_size)
+		return header_size - have;
+	if (PKT_HEADER != buffer[head])
+		return 1;
+	const std::size_t size = header_size + ((std::size_t(buffer[head+1]) << 8) | buffer[head+2]);
+	if (size > max_packet)
+		return 1;
+	return (size > have) ? size - have : 1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DVSIPacket.h"
+
+// splits the byte stream coming from a DVSI device into SDV_Packets
+// bytes are read straight into the receive buffer with Space() and Commit(), and Next()
+// returns each complete packet where it sits in the buffer, so nothing is copied.
+// a packet may arrive in any number of pieces and one read may hold many packets.
+// anything that doesn't look like the start of a packet is skipped and counted
+class CDVSIParser
+{
+public:
+	// the largest packet a device can send
+	static constexpr std::size_t max_packet = sizeof(SDV_Packet);
+
+	CDVSIParser();
+	void Reset();
+
+	// where the next bytes go, and how many will fit. this can move the unparsed bytes
+	// to the front of the buffer, so the last packet from Next() is no longer valid
+	uint8_t *Space(std::size_t &room);
+	// count bytes were put at the pointer from Space()
+	void Commit(std::size_t count);
+
+	// the next complete packet, or nullptr if there isn't one yet
+	// the packet stays valid until the next call to Space()
+	const SDV_Packet *Next();
+
+	// how many more bytes it will take to finish the next packet, at least 1
+	std::size_t Needed() const;
+	// bytes that were thrown away looking for the start of a packet
+	std::size_t Discarded() const { return discarded; }
+
+private:
+	// payload_length counts the field_id and the payload
+	static constexpr std::size_t header_size = 4;
+
+	bool Resync();
+
+	std::size_t head, tail, discarded;
+	uint8_t buffer[4 * USB3XXX_MAXPACKETSIZE];
+
+	static_assert(sizeof(buffer) >= USB3XXX_MAXPACKETSIZE + max_packet, "the receive buffer must hold a partial packet and a full read");
+};
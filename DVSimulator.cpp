@@ -0,0 +1,288 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "DVSimulator.h"
+#include "DVSIFrame.h"
+
+CDVSimulator::CDVSimulator(Edvtype t, const SSimOptions &o) : dvtype(t), options(o), fd(-1), keep_running(false), rng(o.seed), chance(0.0, 1.0) {}
+
+CDVSimulator::~CDVSimulator()
+{
+	Close();
+}
+
+bool CDVSimulator::Open(int &other)
+{
+	int sv[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv))
+	{
+		std::cerr << "Could not make a socket pair for a simulated device: " << strerror(errno) << std::endl;
+		return true;
+	}
+	other = sv[1];
+	return Start(sv[0]);
+}
+
+bool CDVSimulator::Start(int f)
+{
+	fd = f;
+	parser.Reset();
+	outgoing.clear();
+	const auto now = Clock::now();
+	rx_free = tx_free = chan_free[0] = chan_free[1] = chan_free[2] = now;
+	keep_running = true;
+	future = std::async(std::launch::async, &CDVSimulator::Run, this);
+	return false;
+}
+
+void CDVSimulator::Close()
+{
+	keep_running = false;
+	if (future.valid())
+		future.get();
+	if (fd >= 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+}
+
+void CDVSimulator::ReportStats(const std::string &name) const
+{
+	std::cout << name << " simulator: " << controls << " control packets, " << frames << " frames";
+	if (options.fault_rate > 0.0)
+		std::cout << ", " << dropped << " responses dropped, " << damaged << " damaged, " << strays << " stray bytes";
+	if (options.late_rate > 0.0)
+		std::cout << ", " << late << " late";
+	std::cout << std::endl;
+}
+
+// how long the bytes take on the serial line
+CDVSimulator::Clock::duration CDVSimulator::LineTime(std::size_t bytes) const
+{
+	if (0 == options.baudrate)
+		return Clock::duration::zero();
+	// eight data bits, a start bit and a stop bit
+	return std::chrono::nanoseconds(uint64_t(bytes) * 10000000000ull / options.baudrate);
+}
+
+void CDVSimulator::Run()
+{
+	while (keep_running)
+	{
+		// send everything that's due, as fast as the line allows
+		auto now = Clock::now();
+		while (! outgoing.empty() && outgoing.begin()->first <= now && tx_free <= now)
+		{
+			Send(outgoing.begin()->second);
+			outgoing.erase(outgoing.begin());
+			now = Clock::now();
+		}
+
+		// then wait for tcd, or for the next response
+		auto wake = now + std::chrono::milliseconds(100);
+		if (! outgoing.empty())
+			wake = std::min(wake, std::max(outgoing.begin()->first, tx_free));
+		const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wake - now, Clock::duration::zero())).count();
+		const timespec ts { time_t(ns / 1000000000), long(ns % 1000000000) };
+		pollfd pfd { fd, POLLIN, 0 };
+		const auto rv = ppoll(&pfd, 1, &ts, nullptr);
+		if (rv < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			std::cerr << "Simulated device poll error: " << strerror(errno) << std::endl;
+			return;
+		}
+		if (0 == rv)
+			continue;
+
+		std::size_t room;
+		auto buf = parser.Space(room);
+		const auto n = read(fd, buf, room);
+		if (n < 0)
+		{
+			if (EINTR == errno || EAGAIN == errno)
+				continue;
+			std::cerr << "Simulated device read error: " << strerror(errno) << std::endl;
+			return;
+		}
+		if (0 == n)
+			return;	// tcd closed its end
+		parser.Commit(std::size_t(n));
+
+		// the bytes arrive at the line's speed
+		rx_free = std::max(rx_free, Clock::now()) + LineTime(std::size_t(n));
+		const SDV_Packet *p;
+		while (nullptr != (p = parser.Next()))
+			Respond(*p, rx_free);
+	}
+}
+
+void CDVSimulator::Send(SResponse &r)
+{
+	std::size_t bytes = r.size;
+	if (r.is_frame && options.fault_rate > 0.0 && chance(rng) < options.fault_rate)
+	{
+		switch (rng() % 3)
+		{
+		case 0:
+			dropped++;
+			return;
+		case 1:
+			// the last byte is always ambe or audio
+			damaged++;
+			r.data[r.size - 1] ^= 0xffu;
+			break;
+		default:
+		{
+			// the parser has to find the start byte after this
+			strays++;
+			const uint8_t stray = 0;
+			if (1 != write(fd, &stray, 1))
+				return;
+			bytes++;
+			break;
+		}
+		}
+	}
+
+	const uint8_t *data = r.data;
+	std::size_t size = r.size;
+	while (size)
+	{
+		const auto n = write(fd, data, size);
+		if (n < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			return;
+		}
+		data += n;
+		size -= std::size_t(n);
+	}
+	tx_free = std::max(tx_free, Clock::now()) + LineTime(bytes);
+}
+
+void CDVSimulator::Respond(const SDV_Packet &p, Clock::time_point arrived)
+{
+	SResponse r;
+	const bool dv3000 = (Edvtype::dv3000 == dvtype);
+
+	if (PKT_CONTROL == p.header.packet_type)
+	{
+		SDV_Packet c;
+		memset(&c, 0, sizeof(c));
+		c.start_byte = PKT_HEADER;
+		c.header.packet_type = PKT_CONTROL;
+		c.field_id = p.field_id;
+		uint16_t length = 1;
+		switch (p.field_id)
+		{
+		case PKT_RESET:
+			c.field_id = PKT_READY;
+			break;
+		case PKT_PARITYMODE:
+			length = 2;
+			break;
+		case PKT_PRODID:
+			strcpy(c.payload.ctrl.data.prodid, dv3000 ? "AMBE3000R" : "AMBE3003");
+			length += uint16_t(strlen(c.payload.ctrl.data.prodid) + 1);
+			break;
+		case PKT_VERSTRING:
+			strcpy(c.payload.ctrl.data.version, "V120.E100.XXXX.C106.G514.R009.B0010411.C0020208 simulated");
+			length += uint16_t(strlen(c.payload.ctrl.data.version) + 1);
+			break;
+		case PKT_CHANNEL0:
+		case PKT_CHANNEL1:
+		case PKT_CHANNEL2:
+		{
+			// the codec configuration, every field is accepted
+			const uint8_t resp[] { 0x0, PKT_ECMODE, 0x0, PKT_DCMODE, 0x0, PKT_RATEP, 0x0, PKT_CHANFMT, 0x0, PKT_SPCHFMT, 0x0, PKT_GAIN, 0x0, PKT_INIT, 0x0 };
+			memcpy(c.payload.ctrl.data.resp, resp, sizeof(resp));
+			length += sizeof(resp);
+			break;
+		}
+		default:
+			return;
+		}
+		c.header.payload_length = htons(length);
+		r.size = packet_size(c);
+		memcpy(r.data, &c, r.size);
+		r.is_frame = false;
+		controls++;
+		if (PKT_CHANNEL0 <= p.field_id && p.field_id <= PKT_CHANNEL2)
+		{
+			// a channel's configuration waits for the frames it already has
+			auto &free = chan_free[dv3000 ? 0u : unsigned(p.field_id - PKT_CHANNEL0)];
+			free = std::max(free, arrived);
+			outgoing.emplace(free, r);
+		}
+		else
+		{
+			outgoing.emplace(arrived, r);
+		}
+		return;
+	}
+
+	// a frame to vocode
+	const unsigned int channel = dv3000 ? 0u : unsigned(p.field_id - PKT_CHANNEL0);
+	if (channel > 2)
+		return;
+	if (PKT_SPEECH == p.header.packet_type)
+	{
+		// speech in, channel data out
+		const uint8_t *samples = dv3000 ? reinterpret_cast<const uint8_t *>(p.payload.audio3k.samples) : reinterpret_cast<const uint8_t *>(p.payload.audio.samples);
+		uint8_t ambe[9] = { 0 };
+		for (unsigned int i=0; i<320; i++)
+			ambe[i % 9] ^= samples[i];
+		r.size = dv3000 ? WriteChannel3kFrame(r.data, ambe) : WriteChannelFrame(r.data, uint8_t(channel), ambe);
+	}
+	else if (PKT_CHANNEL == p.header.packet_type)
+	{
+		// channel data in, speech out
+		const uint8_t *ambe = dv3000 ? p.payload.ambe3k.data : p.payload.ambe.data;
+		int16_t audio[160];
+		for (unsigned int i=0; i<160; i++)
+			audio[i] = int16_t((ambe[i % 9] << 8) | i);
+		r.size = dv3000 ? WriteSpeech3kFrame(r.data, audio) : WriteSpeechFrame(r.data, uint8_t(channel), audio);
+	}
+	else
+	{
+		return;
+	}
+	r.is_frame = true;
+	frames++;
+
+	// the channel works on one frame at a time
+	auto &free = chan_free[channel];
+	free = std::max(free, arrived) + std::chrono::microseconds(options.latency);
+	if (options.late_rate > 0.0 && chance(rng) < options.late_rate)
+	{
+		late++;
+		free += std::chrono::microseconds(options.late_by);
+	}
+	outgoing.emplace(free, r);
+}
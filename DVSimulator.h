@@ -0,0 +1,86 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <string>
+#include <map>
+#include <atomic>
+#include <future>
+#include <chrono>
+#include <random>
+
+#include "DVSIParser.h"
+
+struct SSimOptions
+{
+	unsigned int latency = 0;	// microseconds the vocoder takes for each frame
+	unsigned int baudrate = 0;	// the serial line speed in each direction, 0 is no limit
+	double fault_rate = 0.0;	// the chance that a frame's response is dropped, damaged or follows a stray byte
+	double late_rate = 0.0;	// the chance that a frame holds up its channel for late_by, so its response and the ones after it are late
+	unsigned int late_by = 500000;	// microseconds
+	uint32_t seed = 1;	// for the faults, so a run can be repeated
+};
+
+// a software DVSI device, the vocoder end of the serial line
+// it runs in its own thread on one end of a socketpair and speaks the packet
+// protocol in DVSIPacket.h: it answers reset, parity, product id, version and codec
+// configuration, and it answers every speech frame with a channel frame and every channel
+// frame with a speech frame. it doesn't really vocode. the "ambe" is a checksum of the audio
+// and the audio is a pattern made from the ambe, so the output can be checked. each channel
+// takes latency for each of its frames, and the line can be throttled to a baud rate. a channel
+// answers its frames and its configuration in the order they came
+class CDVSimulator
+{
+public:
+	CDVSimulator(Edvtype t, const SSimOptions &o);
+	~CDVSimulator();
+
+	// starts the simulator on one end of a socketpair, fd is the other end
+	// returns true on failure
+	bool Open(int &fd);
+	void Close();
+	void ReportStats(const std::string &name) const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+	struct SResponse
+	{
+		uint8_t data[sizeof(SDV_Packet)];
+		unsigned int size;
+		bool is_frame;
+	};
+
+	bool Start(int fd);
+	void Run();
+	void Respond(const SDV_Packet &p, Clock::time_point arrived);
+	void Send(SResponse &r);
+	Clock::duration LineTime(std::size_t bytes) const;
+
+	const Edvtype dvtype;
+	const SSimOptions options;
+	int fd;
+	std::atomic<bool> keep_running;
+	std::future<void> future;
+	// only the simulator thread uses these
+	CDVSIParser parser;
+	std::multimap<Clock::time_point, SResponse> outgoing;	// by when they're due
+	Clock::time_point rx_free, tx_free, chan_free[3];	// when the line and the vocoder channels are idle
+	std::mt19937 rng;
+	std::uniform_real_distribution<double> chance;
+	// statistics
+	std::atomic<uint64_t> controls { 0 }, frames { 0 }, dropped { 0 }, damaged { 0 }, strays { 0 }, late { 0 };
+};
@@ -0,0 +1,88 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "DVStandIn.h"
+
+bool CStandInPort::Open()
+{
+	return simulator.Open(fd);
+}
+
+void CStandInPort::Close()
+{
+	if (fd >= 0)
+	{
+		close(fd);
+		fd = -1;
+	}
+	simulator.Close();
+}
+
+FT_STATUS CStandInPort::Write(const void *buf, DWORD size, DWORD &written)
+{
+	written = 0;
+	auto data = static_cast<const uint8_t *>(buf);
+	while (written < size)
+	{
+		const auto n = write(fd, data + written, size - written);
+		if (n < 0)
+		{
+			if (EINTR == errno)
+				continue;
+			return FT_IO_ERROR;
+		}
+		written += DWORD(n);
+	}
+	return FT_OK;
+}
+
+FT_STATUS CStandInPort::Available(DWORD &count, int timeout_ms)
+{
+	count = 0;
+	pollfd pfd { fd, POLLIN, 0 };
+	const auto rv = poll(&pfd, 1, timeout_ms);
+	if (rv < 0 && EINTR != errno)
+		return FT_IO_ERROR;
+	if (rv > 0)
+	{
+		if (pfd.revents & (POLLHUP | POLLERR))
+			return FT_IO_ERROR;
+		int n = 0;
+		if (ioctl(fd, FIONREAD, &n))
+			return FT_IO_ERROR;
+		count = DWORD(n);
+	}
+	return FT_OK;
+}
+
+FT_STATUS CStandInPort::Read(void *buf, DWORD size, DWORD &bytes_read, int timeout_ms)
+{
+	bytes_read = 0;
+	DWORD count;
+	const auto status = Available(count, timeout_ms);
+	if (FT_OK != status || 0 == count)
+		return status;
+	const auto n = read(fd, buf, size);
+	if (n < 0)
+		return (EINTR == errno) ? FT_OK : FT_IO_ERROR;
+	bytes_read = DWORD(n);
+	return FT_OK;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <string>
+
+#include "DVSimulator.h"
+#include "DV3000.h"
+#include "DV3003.h"
+
+// the tcd end of the line to a CDVSimulator, in place of an FTDI port
+class CStandInPort
+{
+public:
+	CStandInPort(Edvtype t, const SSimOptions &o) : simulator(t, o), fd(-1) {}
+	~CStandInPort() { Close(); }
+
+	bool Open();	// true on failure
+	void Close();
+	FT_STATUS Write(const void *buf, DWORD size, DWORD &written);
+	// these wait up to timeout for something to read
+	FT_STATUS Read(void *buf, DWORD size, DWORD &bytes_read, int timeout_ms);
+	FT_STATUS Available(DWORD &count, int timeout_ms);
+	void ReportStats(const std::string &name) const { simulator.ReportStats(name); }
+
+private:
+	CDVSimulator simulator;
+	int fd;
+};
+
+// a DV3000 or DV3003 that talks to a simulated device instead of real hardware, so the
+// device pool and everything around it can be run, and load tested, without any hardware
+template <typename TDevice> class CDVStandIn : public TDevice
+{
+public:
+	CDVStandIn(Encoding e, Edvtype t, const SSimOptions &o) : TDevice(e), port(t, o) {}
+	~CDVStandIn() { this->CloseDevice(); }
+
+	void ReportStats() const override
+	{
+		TDevice::ReportStats();
+		port.ReportStats(this->description);
+	}
+
+protected:
+	bool OpenPort(const std::string &, Edvtype) override
+	{
+		if (port.Open())
+			return true;
+		std::cout << "Opened " << this->description << ", a simulated device" << std::endl;
+		return false;
+	}
+	void ClosePort() override { port.Close(); }
+	FT_STATUS WritePort(const void *buf, DWORD size, DWORD &written) override
+	{
+		return port.Write(buf, size, written);
+	}
+	FT_STATUS ReadPort(void *buf, DWORD size, DWORD &bytes_read) override
+	{
+		return port.Read(buf, size, bytes_read, 1000);
+	}
+	bool WaitForRx(DWORD &count) override
+	{
+		const auto status = port.Available(count, 10);
+		if (FT_OK != status)
+		{
+			this->FTDI_Error("simulated device", status);
+			return true;
+		}
+		return false;
+	}
+	// the reader's wait is short, so it will see keep_running soon enough
+	void WakeReader() override {}
+
+private:
+	CStandInPort port;
+};
@@ -0,0 +1,460 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <algorithm>
+
+#include "DevicePool.h"
+#include "DVStandIn.h"
+#include "Configure.h"
+#include "Controller.h"
+
+extern CConfigure g_Conf;
+extern CController g_Cont;
+
+Edvtype CDevicePool::GetType(const std::string &desc)
+{
+	if (0==desc.compare("ThumbDV") || 0==desc.compare("DVstick-30") || 0==desc.compare("USB-3000") || 0==desc.compare("FT230X Basic UART"))
+		return Edvtype::dv3000;
+	// the USB-3003, and each half of a USB-3006, has three channels
+	return Edvtype::dv3003;
+}
+
+bool CDevicePool::Open(const std::list<std::pair<std::string, std::string>> &found, const std::string &modules, bool dmr_in_software, bool stand_in)
+{
+	if (found.empty())
+	{
+		std::cerr << "could not find a device!" << std::endl;
+		return true;
+	}
+
+	// the biggest devices are placed first, each one where the capacity is lowest
+	struct SFound
+	{
+		std::string serialno, desc;
+		Edvtype dvtype;
+		unsigned int channels;
+		Encoding type;
+	};
+	std::vector<SFound> list;
+	for (const auto &f : found)
+	{
+		const auto dvtype = GetType(f.second);
+		list.push_back({ f.first, f.second, dvtype, (Edvtype::dv3000 == dvtype) ? 1u : 3u, Encoding::dstar });
+	}
+	std::stable_sort(list.begin(), list.end(), [](const SFound &a, const SFound &b) { return a.channels > b.channels; });
+	unsigned int capacity[2] { 0, 0 };
+	for (auto &f : list)
+	{
+		if (! dmr_in_software && capacity[Index(Encoding::dmrsf)] < capacity[Index(Encoding::dstar)])
+			f.type = Encoding::dmrsf;
+		capacity[Index(f.type)] += f.channels;
+	}
+
+	std::cout << "DVSI device pool: " << list.size() << " devices with " << capacity[0] << " D-Star channels";
+	if (dmr_in_software)
+		std::cout << ", DMR/YSF is done in software";
+	else
+		std::cout << " and " << capacity[1] << " DMR/YSF channels";
+	std::cout << ", shared by " << modules.size() << " transcoded modules" << std::endl;
+
+	if (0 == capacity[0] || (! dmr_in_software && 0 == capacity[1]))
+	{
+		std::cerr << "There has to be at least one device for D-Star and one for DMR/YSF" << std::endl;
+		return true;
+	}
+	if (modules.size() > capacity[0] || (! dmr_in_software && modules.size() > capacity[1]))
+		std::cout << "There are more modules than channels, so they can't all be transcoding at once" << std::endl;
+
+	// open each device
+	for (const auto &f : list)
+	{
+		std::unique_ptr<CDVDevice> device;
+		if (stand_in)
+		{
+			SSimOptions options;
+			options.latency = g_Conf.GetStandInLatency();
+			const auto baudrate = g_Conf.GetStandInBaudRate();
+			options.baudrate = (baudrate < 0) ? ((Edvtype::dv3000 == f.dvtype) ? 460800u : 921600u) : unsigned(baudrate);
+			options.fault_rate = g_Conf.GetStandInFaultPercent() / 100.0;
+			options.seed = uint32_t(devices.size() + 1);
+			if (Edvtype::dv3000 == f.dvtype)
+				device.reset(new CDVStandIn<CDV3000>(f.type, f.dvtype, options));
+			else
+				device.reset(new CDVStandIn<CDV3003>(f.type, f.dvtype, options));
+		}
+		else
+		{
+			if (Edvtype::dv3000 == f.dvtype)
+				device.reset(new CDV3000(f.type));
+			else
+				device.reset(new CDV3003(f.type));
+		}
+
+		int8_t in_gain, out_gain;
+		GetGains(f.type, in_gain, out_gain);
+		if (device->OpenDevice(f.serialno, f.desc, f.dvtype, in_gain, out_gain))
+			return true;
+		std::cout << device->GetDescription() << " does " << ((Encoding::dstar == f.type) ? "D-Star" : "DMR/YSF") << std::endl;
+		devices.push_back(std::move(device));
+	}
+
+	// the channels, the first channel of every device, then the second, and so on
+	const auto now = Clock::now();
+	for (unsigned int ch=0; ch<3; ch++)
+	{
+		for (unsigned int d=0; d<devices.size(); d++)
+		{
+			if (ch < list[d].channels)
+				slots.push_back({ devices[d].get(), ch, list[d].type, false, false, now, now - reassign_hold });
+		}
+	}
+	// with DMR in software, there's nowhere to switch a channel to
+	reassign = ! dmr_in_software;
+
+	return false;
+}
+
+void CDevicePool::Start()
+{
+	for (auto &device : devices)
+		device->Start();
+}
+
+void CDevicePool::ReportStats()
+{
+	for (const auto &device : devices)
+		device->ReportStats();
+	std::lock_guard<std::mutex> lock(mux);
+	for (unsigned int i=0; i<2; i++)
+	{
+		const auto type = i ? Encoding::dmrsf : Encoding::dstar;
+		const auto count = std::count_if(slots.begin(), slots.end(), [type](const SSlot &slot) { return type == slot.type; });
+		const auto &e = enc[i];
+		if (0 == count && 0 == e.allocations)
+			continue;
+		std::cout << (i ? "DMR/YSF" : "D-Star") << " channels: " << e.allocations << " allocated, " << e.failures << " streams found no free channel, "
+			<< e.timeouts << " streams timed out, " << e.silenced << " frames of silence, peak of " << e.peak << " channels in use at once, "
+			<< e.reassigned << " channels switched to " << (i ? "DMR/YSF" : "D-Star") << ", " << count << " channels now" << std::endl;
+	}
+}
+
+void CDevicePool::Collect(CMetrics &metrics)
+{
+	// the device list doesn't change while the transcoder is running
+	struct SSample
+	{
+		std::string labels;
+		unsigned int depth;
+		CDVDevice::SChannelStats stats;
+	};
+	std::vector<SSample> channels;
+	for (std::size_t d=0; d<devices.size(); d++)
+	{
+		const auto &device = devices[d];
+		for (unsigned int ch=0; ch<device->GetChannels(); ch++)
+		{
+			const auto stats = device->GetChannelStats(ch);
+			const auto labels = CMetrics::Label("device", std::to_string(d)) + ',' + CMetrics::Label("description", device->GetDescription()) + ',' + CMetrics::Label("channel", std::to_string(ch)) + ','
+				+ CMetrics::Label("encoding", (Encoding::dstar == stats.encoding) ? "dstar" : "dmrsf");
+			channels.push_back(SSample { labels, device->GetDepth(), stats });
+		}
+	}
+
+	metrics.Family("tcd_dvsi_channel_in_flight", "gauge", "Frames a DVSI channel is working on, it can have up to its depth at once");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_in_flight", c.labels, uint64_t(c.stats.in_flight));
+	metrics.Family("tcd_dvsi_channel_depth", "gauge", "The most frames a DVSI channel is given at once");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_depth", c.labels, uint64_t(c.depth));
+	metrics.Family("tcd_dvsi_channel_pending", "gauge", "Frames waiting for a DVSI channel to have room");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_pending", c.labels, uint64_t(c.stats.pending));
+	metrics.Family("tcd_dvsi_channel_frames_total", "counter", "Frames a DVSI channel has returned");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_frames_total", c.labels, c.stats.frames);
+	metrics.Family("tcd_dvsi_channel_timeouts_total", "counter", "Frames a DVSI channel never returned, or returned while it was resynced, they were dropped and their credits given back");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_timeouts_total", c.labels, c.stats.timeouts);
+	metrics.Family("tcd_dvsi_channel_resyncs_total", "counter", "Times a DVSI channel was reconfigured after a frame timed out, so its answers match its frames again");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_resyncs_total", c.labels, c.stats.resyncs);
+	metrics.Family("tcd_dvsi_channel_round_trip_us", "summary", "Time from writing a frame to a DVSI channel until it comes back, in microseconds");
+	for (const auto &c : channels)
+	{
+		metrics.Sample("tcd_dvsi_channel_round_trip_us_sum", c.labels, c.stats.rtt_total);
+		metrics.Sample("tcd_dvsi_channel_round_trip_us_count", c.labels, c.stats.frames);
+	}
+	metrics.Family("tcd_dvsi_channel_round_trip_max_us", "gauge", "The longest DVSI round trip, in microseconds");
+	for (const auto &c : channels)
+		metrics.Sample("tcd_dvsi_channel_round_trip_max_us", c.labels, c.stats.rtt_max);
+	metrics.Family("tcd_dvsi_channel_reconfigurations_total", "counter", "DVSI channels switched between D-Star and DMR/YSF, by result");
+	for (const auto &c : channels)
+	{
+		metrics.Sample("tcd_dvsi_channel_reconfigurations_total", c.labels + ",result=\"ok\"", c.stats.reconfigs);
+		metrics.Sample("tcd_dvsi_channel_reconfigurations_total", c.labels + ",result=\"failed\"", c.stats.reconfig_failures);
+	}
+	metrics.Family("tcd_dvsi_device_responses_total", "counter", "Packets read from a DVSI device");
+	for (std::size_t d=0; d<devices.size(); d++)
+		metrics.Sample("tcd_dvsi_device_responses_total", CMetrics::Label("device", std::to_string(d)) + ',' + CMetrics::Label("description", devices[d]->GetDescription()), devices[d]->GetResponses());
+	metrics.Family("tcd_dvsi_device_reads_total", "counter", "Reads from a DVSI device, a read can have several packets");
+	for (std::size_t d=0; d<devices.size(); d++)
+		metrics.Sample("tcd_dvsi_device_reads_total", CMetrics::Label("device", std::to_string(d)) + ',' + CMetrics::Label("description", devices[d]->GetDescription()), devices[d]->GetReads());
+
+	// a quick copy, so the lock isn't held while the page is written
+	unsigned int count[2], active[2];
+	SEncoding e[2];
+	{
+		std::lock_guard<std::mutex> lock(mux);
+		for (unsigned int i=0; i<2; i++)
+		{
+			const auto type = i ? Encoding::dmrsf : Encoding::dstar;
+			count[i] = unsigned(std::count_if(slots.begin(), slots.end(), [type](const SSlot &slot) { return type == slot.type; }));
+			active[i] = enc[i].active;
+			e[i].allocations = enc[i].allocations;
+			e[i].failures = enc[i].failures;
+			e[i].timeouts = enc[i].timeouts;
+			e[i].silenced = enc[i].silenced;
+			e[i].reassigned = enc[i].reassigned;
+		}
+	}
+	const std::string encoding[2] { "encoding=\"dstar\"", "encoding=\"dmrsf\"" };
+	metrics.Family("tcd_dvsi_channels", "gauge", "DVSI channels doing each encoding");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_channels", encoding[i], uint64_t(count[i]));
+	metrics.Family("tcd_dvsi_channels_busy", "gauge", "DVSI channels that have a stream");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_channels_busy", encoding[i], uint64_t(active[i]));
+	metrics.Family("tcd_dvsi_allocations_total", "counter", "Streams given a DVSI channel");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_allocations_total", encoding[i], e[i].allocations);
+	metrics.Family("tcd_dvsi_allocation_failures_total", "counter", "Streams that found no free DVSI channel");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_allocation_failures_total", encoding[i], e[i].failures);
+	metrics.Family("tcd_dvsi_stream_timeouts_total", "counter", "Streams that gave their DVSI channel back because they went quiet");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_stream_timeouts_total", encoding[i], e[i].timeouts);
+	metrics.Family("tcd_dvsi_silenced_frames_total", "counter", "Frames that got silence because their stream had no DVSI channel");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_silenced_frames_total", encoding[i], e[i].silenced);
+	metrics.Family("tcd_dvsi_reassigned_total", "counter", "Idle DVSI channels switched to this encoding");
+	for (unsigned int i=0; i<2; i++)
+		metrics.Sample("tcd_dvsi_reassigned_total", encoding[i], e[i].reassigned);
+}
+
+void CDevicePool::Close()
+{
+	for (auto &device : devices)
+		device->CloseDevice();
+	std::lock_guard<std::mutex> lock(mux);
+	slots.clear();
+	for (auto &e : enc)
+		e.streams.clear();
+	devices.clear();
+}
+
+void CDevicePool::GetGains(Encoding type, int8_t &in_gain, int8_t &out_gain)
+{
+	const bool dstar = (Encoding::dstar == type);
+	in_gain  = int8_t(g_Conf.GetGain(dstar ? EGainType::dstarin  : EGainType::dmrin));
+	out_gain = int8_t(g_Conf.GetGain(dstar ? EGainType::dstarout : EGainType::dmrout));
+}
+
+// channels that have finished switching can be used again
+void CDevicePool::Settle()
+{
+	for (auto &slot : slots)
+	{
+		if (slot.moving && ! slot.device->IsReconfiguring(slot.channel))
+		{
+			slot.moving = false;
+			slot.type = slot.device->GetEncoding(slot.channel);
+		}
+	}
+}
+
+// give the stream a free channel, taking one back from an idle stream if it has to
+void CDevicePool::Allocate(Encoding type, SStream &s, Clock::time_point now)
+{
+	auto &e = enc[Index(type)];
+	Settle();
+	for (int pass=0; pass<2; pass++)
+	{
+		for (std::size_t i=0; i<slots.size(); i++)
+		{
+			auto &slot = slots[i];
+			if (type == slot.type && ! slot.busy && ! slot.moving)
+			{
+				slot.busy = true;
+				s.slot = i;
+				e.allocations++;
+				if (++e.active > e.peak)
+					e.peak = e.active;
+				return;
+			}
+		}
+		if (pass)
+			break;
+		// nothing is free, so look for streams that ended without a last frame
+		for (auto it=e.streams.begin(); it!=e.streams.end(); )
+		{
+			if (no_slot != it->second.slot && &it->second != &s && now - it->second.last > stream_timeout)
+			{
+				slots[it->second.slot].busy = false;
+				slots[it->second.slot].idle_since = now;
+				e.active--;
+				e.timeouts++;
+				it = e.streams.erase(it);
+			}
+			else
+				it++;
+		}
+	}
+	s.slot = no_slot;
+
+	// maybe the other encoding can spare a channel, this stream will get it when it's ready
+	if (reassign)
+		Reassign(type, now);
+}
+
+// starts switching an idle channel of the other encoding to this one, returns true if it did
+bool CDevicePool::Reassign(Encoding type, Clock::time_point now)
+{
+	const Encoding other = (Encoding::dstar == type) ? Encoding::dmrsf : Encoding::dstar;
+
+	// don't switch more channels than there are streams waiting for one
+	const auto &e = enc[Index(type)];
+	const auto waiting = std::count_if(e.streams.begin(), e.streams.end(), [](const std::pair<const char, SStream> &p) { return no_slot == p.second.slot; });
+	long total = 0, spare = 0, moving = 0;
+	for (const auto &slot : slots)
+	{
+		if (other != slot.type)
+			continue;
+		total++;
+		if (slot.moving)
+			moving++;
+		else if (! slot.busy)
+			spare++;
+	}
+	// the other encoding keeps at least one channel, and a free one for its next stream
+	if (moving >= waiting || total < 2 || spare < 2)
+		return false;
+
+	for (auto &slot : slots)
+	{
+		if (other == slot.type && ! slot.busy && ! slot.moving && now - slot.idle_since >= reassign_idle && now - slot.moved >= reassign_hold)
+		{
+			int8_t in_gain, out_gain;
+			GetGains(type, in_gain, out_gain);
+			slot.moving = true;
+			slot.moved = now;
+			slot.device->Reconfigure(slot.channel, type, in_gain, out_gain);
+			enc[Index(type)].reassigned++;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CDevicePool::Release(Encoding type, char module, Clock::time_point now)
+{
+	auto &e = enc[Index(type)];
+	auto it = e.streams.find(module);
+	if (e.streams.end() == it)
+		return;
+	if (no_slot != it->second.slot)
+	{
+		slots[it->second.slot].busy = false;
+		slots[it->second.slot].idle_since = now;
+		e.active--;
+	}
+	e.streams.erase(it);
+}
+
+void CDevicePool::AddPacket(Encoding type, const std::shared_ptr<CTranscoderPacket> &packet)
+{
+	packet->Stamp((Encoding::dstar == type) ? EStage::dstar_queued : EStage::dmr_queued);
+	auto &e = enc[Index(type)];
+	const char module = packet->GetModule();
+	const auto now = Clock::now();
+	CDVDevice *device = nullptr;
+	unsigned int channel = 0;
+	{
+		std::lock_guard<std::mutex> lock(mux);
+		auto it = e.streams.find(module);
+		if (e.streams.end() != it && it->second.streamid != packet->GetStreamId())
+		{
+			// a new stream on this module, without a last frame from the old one
+			Release(type, module, now);
+			it = e.streams.end();
+		}
+		if (e.streams.end() == it)
+		{
+			it = e.streams.emplace(module, SStream { packet->GetStreamId(), no_slot, now }).first;
+			Allocate(type, it->second, now);
+			if (no_slot == it->second.slot)
+				e.failures++;
+		}
+		else if (no_slot == it->second.slot)
+		{
+			// this stream didn't get a channel, maybe there's one now
+			Allocate(type, it->second, now);
+		}
+		auto &s = it->second;
+		s.last = now;
+		if (no_slot == s.slot)
+		{
+			e.silenced++;
+		}
+		else
+		{
+			device = slots[s.slot].device;
+			channel = slots[s.slot].channel;
+		}
+		if (packet->IsLast())
+			Release(type, module, now);
+	}
+
+	if (device)
+		device->AddPacket(packet, channel);
+	else
+		FillWithSilence(type, packet);
+}
+
+// this does what the device would have done, but with silence
+void CDevicePool::FillWithSilence(Encoding type, const std::shared_ptr<CTranscoderPacket> &packet)
+{
+	static const uint8_t dstar_silence[9] { 0x9e, 0x8d, 0x32, 0x88, 0x26, 0x1a, 0x3f, 0x61, 0xe8 };
+	static const uint8_t dmr_silence[9]   { 0xb9, 0xe8, 0x81, 0x52, 0x61, 0x73, 0x00, 0x2a, 0x6b };
+	static const int16_t audio_silence[160] { 0 };
+
+	if (Encoding::dstar == type)
+	{
+		if (packet->DStarIsSet())
+			packet->SetAudioSamples(audio_silence, false);
+		else
+			packet->SetDStarData(dstar_silence);
+		g_Cont.RouteDstPacket(packet);
+	}
+	else
+	{
+		if (packet->DMRIsSet())
+			packet->SetAudioSamples(audio_silence, false);
+		else
+			packet->SetDMRData(dmr_silence);
+		g_Cont.RouteDmrPacket(packet);
+	}
+}
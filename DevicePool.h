@@ -0,0 +1,104 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+#include "DVSIDevice.h"
+#include "Metrics.h"
+
+// all the DVSI devices, any number of them, of any type
+// the channels are split between D-Star and DMR/YSF so the capacity is as even as
+// possible. a stream is given a channel of each type when its first frame arrives, and
+// gives it back with its last frame, or when it has been idle for stream_timeout, so any
+// number of modules can share the channels, as long as there aren't more streams at once
+// than there are channels. if there is no free channel, the stream's frames get AMBE
+// silence, or audio silence, until a channel is free.
+// when one encoding runs out of channels while the other has some to spare, an idle
+// channel is switched over. a channel has to be idle for reassign_idle before it can be
+// switched, and it can't be switched again for reassign_hold, so the channels don't flap
+class CDevicePool
+{
+public:
+	// a stream that has sent nothing for this long doesn't need its channels any more
+	static constexpr std::chrono::milliseconds stream_timeout { 1000 };
+	static constexpr std::chrono::milliseconds reassign_idle { 2000 };
+	static constexpr std::chrono::milliseconds reassign_hold { 10000 };
+
+	// found is the serial number and the description of each device
+	// with dmr_in_software, every device does D-Star
+	// with stand_in, the devices are software stand-ins, and need no hardware
+	// returns true on failure
+	bool Open(const std::list<std::pair<std::string, std::string>> &found, const std::string &modules, bool dmr_in_software, bool stand_in);
+	void Start();
+	void Close();
+	void ReportStats();
+	// the device and channel metrics, for the metrics page
+	void Collect(CMetrics &metrics);
+
+	// send the packet to its stream's channel
+	void AddPacket(Encoding type, const std::shared_ptr<CTranscoderPacket> &packet);
+
+	static Edvtype GetType(const std::string &description);
+
+private:
+	using Clock = std::chrono::steady_clock;
+	struct SSlot
+	{
+		CDVDevice *device;
+		unsigned int channel;
+		Encoding type;
+		bool busy, moving;	// moving is true while the device is reconfiguring the channel
+		Clock::time_point idle_since, moved;
+	};
+	static constexpr std::size_t no_slot = SIZE_MAX;
+	struct SStream
+	{
+		uint16_t streamid;
+		std::size_t slot;	// no_slot if there wasn't a free channel for it
+		Clock::time_point last;
+	};
+	struct SEncoding
+	{
+		std::unordered_map<char, SStream> streams;	// each module's active stream
+		// the counters
+		uint64_t allocations = 0, failures = 0, timeouts = 0, silenced = 0, reassigned = 0;
+		unsigned int active = 0, peak = 0;
+	};
+
+	static unsigned int Index(Encoding type) { return (Encoding::dstar == type) ? 0u : 1u; }
+	static void GetGains(Encoding type, int8_t &in_gain, int8_t &out_gain);
+	void Settle();
+	void Allocate(Encoding type, SStream &s, Clock::time_point now);
+	bool Reassign(Encoding type, Clock::time_point now);
+	void Release(Encoding type, char module, Clock::time_point now);
+	void FillWithSilence(Encoding type, const std::shared_ptr<CTranscoderPacket> &packet);
+
+	std::vector<std::unique_ptr<CDVDevice>> devices;
+	bool reassign = false;
+	std::mutex mux;	// for everything below
+	std::vector<SSlot> slots;	// interleaved over the devices, so streams are spread across them
+	SEncoding enc[2];
+};
@@ -0,0 +1,172 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+#include "Latency.h"
+
+unsigned CLatencyHistogram::Bucket(uint64_t us)
+{
+	if (us < 4)
+		return unsigned(us);
+	const unsigned octave = 63u - unsigned(__builtin_clzll(us));
+	if (octave > 31)
+		return buckets - 1;
+	return 4 * (octave - 1) + unsigned((us >> (octave - 2)) & 3u);
+}
+
+uint64_t CLatencyHistogram::UpperBound(unsigned bucket)
+{
+	if (bucket < 4)
+		return bucket + 1;
+	return uint64_t(5 + bucket % 4) << (bucket / 4 - 1);
+}
+
+void CLatencyHistogram::Add(uint64_t us)
+{
+	counts[Bucket(us)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum.fetch_add(us, std::memory_order_relaxed);
+	auto m = max.load(std::memory_order_relaxed);
+	while (us > m && ! max.compare_exchange_weak(m, us, std::memory_order_relaxed))
+		;
+}
+
+uint64_t CLatencyHistogram::Percentile(double p) const
+{
+	// the buckets can change while this runs, so it only uses their own total
+	// a bucket's upper bound can be more than anything in it, so it's capped at the maximum
+	uint64_t c[buckets], total = 0;
+	for (unsigned b=0; b<buckets; b++)
+		total += (c[b] = BucketCount(b));
+	if (0 == total)
+		return 0;
+	const uint64_t target = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100.0 * double(total))));
+	uint64_t seen = 0;
+	for (unsigned b=0; b<buckets; b++)
+	{
+		seen += c[b];
+		if (seen >= target)
+			return std::min(UpperBound(b), Max());
+	}
+	return Max();
+}
+
+void CLatencyStats::Init(const std::string &modules)
+{
+	mods.assign(modules);
+	for (auto m : modules)
+	{
+		histograms[m - 'A'].reset(new CLatencyHistogram[paths * unsigned(EStage::count)]);
+		late[m - 'A'].reset(new std::atomic<uint64_t>[paths]());
+	}
+}
+
+const CLatencyHistogram *CLatencyStats::Get(char module, ECodecType path, EStage stage) const
+{
+	return Find(module, path, stage);
+}
+
+uint64_t CLatencyStats::Late(char module, ECodecType path) const
+{
+	if (nullptr == Find(module, path, EStage::sent))
+		return 0;
+	return late[module - 'A'][unsigned(path)].load(std::memory_order_relaxed);
+}
+
+CLatencyHistogram *CLatencyStats::Find(char module, ECodecType path, EStage stage) const
+{
+	if (module < 'A' || module > 'Z' || ! histograms[module - 'A'] || unsigned(path) >= paths)
+		return nullptr;
+	return &histograms[module - 'A'][unsigned(path) * unsigned(EStage::count) + unsigned(stage)];
+}
+
+void CLatencyStats::Record(const CTranscoderPacket &packet)
+{
+	const auto module = packet.GetModule();
+	const auto path = packet.GetCodecIn();
+	if (nullptr == Find(module, path, EStage::received))
+		return;
+
+	// the codec the packet came in with was set when it was received
+	EStage input;
+	switch (path)
+	{
+	case ECodecType::dstar: input = EStage::dstar; break;
+	case ECodecType::dmr:   input = EStage::dmr;   break;
+	case ECodecType::p25:   input = EStage::p25;   break;
+	case ECodecType::usrp:  input = EStage::usrp;  break;
+	default:                input = EStage::m17;   break;
+	}
+
+	const auto received = packet.GetStamp(EStage::received);
+	for (unsigned s=unsigned(EStage::received)+1; s<unsigned(EStage::count); s++)
+	{
+		const auto t = packet.GetStamp(EStage(s));
+		if (t >= received && EStage(s) != input)
+			Find(module, path, EStage(s))->Add(uint64_t(t - received) / 1000u);
+	}
+	if (packet.GetStamp(EStage::sent) - received > int64_t(late_us * 1000u))
+		late[module - 'A'][unsigned(path)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void CLatencyStats::Report(std::ostream &os) const
+{
+	os << "Latency in microseconds from when a packet was received, by module and input codec, percentiles are bucket upper bounds" << std::endl;
+	for (auto m : mods)
+	{
+		for (unsigned p=1; p<paths; p++)
+		{
+			const auto sent = Get(m, ECodecType(p), EStage::sent);
+			if (0 == sent->Count())
+				continue;
+			os << "Module " << m << ", " << PathName(ECodecType(p)) << " in, " << sent->Count() << " packets sent" << std::endl;
+			os << "  " << std::left << std::setw(16) << "stage" << std::right << std::setw(10) << "count" << std::setw(9) << "mean" << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99" << std::setw(9) << "p99.9" << std::setw(9) << "max" << std::endl;
+			for (unsigned s=unsigned(EStage::received)+1; s<unsigned(EStage::count); s++)
+			{
+				const auto h = Get(m, ECodecType(p), EStage(s));
+				const auto count = h->Count();
+				if (0 == count)
+					continue;
+				os << "  " << std::left << std::setw(16) << StageName(EStage(s)) << std::right << std::setw(10) << count << std::setw(9) << h->Sum() / count
+					<< std::setw(9) << h->Percentile(50.0) << std::setw(9) << h->Percentile(90.0) << std::setw(9) << h->Percentile(99.0) << std::setw(9) << h->Percentile(99.9) << std::setw(9) << h->Max() << std::endl;
+			}
+		}
+	}
+}
+
+const char *CLatencyStats::PathName(ECodecType path)
+{
+	switch (path)
+	{
+	case ECodecType::dstar:   return "dstar";
+	case ECodecType::dmr:     return "dmr";
+	case ECodecType::c2_1600: return "c2_1600";
+	case ECodecType::c2_3200: return "c2_3200";
+	case ECodecType::p25:     return "p25";
+	case ECodecType::usrp:    return "usrp";
+	default:                  return "none";
+	}
+}
+
+const char *CLatencyStats::StageName(EStage stage)
+{
+	static const char *names[] { "received", "dstar_queued", "dmr_queued", "codec2_queued", "imbe_queued", "usrp_queued", "swambe2_queued", "decoded", "dstar", "dmr", "m17", "p25", "usrp", "sent" };
+	static_assert(sizeof(names) / sizeof(names[0]) == unsigned(EStage::count), "a stage is missing a name");
+	return names[unsigned(stage)];
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <ostream>
+
+#include "TranscoderPacket.h"
+
+// a histogram of latencies in microseconds
+// the buckets are exact up to 4 us, and then each octave has four, so a bucket is never more than 25% wide
+// adding is lock free, so any thread can add while another one reads
+class CLatencyHistogram
+{
+public:
+	static constexpr unsigned buckets = 124;	// up to 2^32 us, more than an hour
+
+	void Add(uint64_t us);
+	uint64_t Count() const { return count.load(std::memory_order_relaxed); }
+	uint64_t Sum() const { return sum.load(std::memory_order_relaxed); }
+	uint64_t Max() const { return max.load(std::memory_order_relaxed); }
+	uint64_t BucketCount(unsigned bucket) const { return counts[bucket].load(std::memory_order_relaxed); }
+	// the smallest latency that won't fit in the bucket
+	static uint64_t UpperBound(unsigned bucket);
+	// the upper bound of the bucket with the p'th percentile, p from 0 to 100, but no more than the maximum
+	uint64_t Percentile(double p) const;
+
+private:
+	static unsigned Bucket(uint64_t us);
+
+	std::atomic<uint64_t> counts[buckets] {}, count { 0 }, sum { 0 }, max { 0 };
+};
+
+// a histogram for each stage of each module's packets, by the codec they came in with
+// the latency of a stage is the time from when the packet was received to when it reached the stage
+class CLatencyStats
+{
+public:
+	static constexpr unsigned paths = 7;	// each ECodecType
+	// a packet is late if it's sent more than three frames after it was received
+	static constexpr uint64_t late_us = 60000;
+
+	void Init(const std::string &modules);
+	// call this when the packet has been sent
+	void Record(const CTranscoderPacket &packet);
+	// this can be called at any time, the numbers keep coming while it runs
+	void Report(std::ostream &os) const;
+	// nullptr if the module isn't transcoded
+	const CLatencyHistogram *Get(char module, ECodecType path, EStage stage) const;
+	// how many of the module's packets were late, 0 if the module isn't transcoded
+	uint64_t Late(char module, ECodecType path) const;
+
+	static const char *PathName(ECodecType path);
+	static const char *StageName(EStage stage);
+
+private:
+	CLatencyHistogram *Find(char module, ECodecType path, EStage stage) const;
+
+	std::string mods;
+	std::unique_ptr<CLatencyHistogram[]> histograms[26];	// for 'A' to 'Z'
+	std::unique_ptr<std::atomic<uint64_t>[]> late[26];	// for each path
+};
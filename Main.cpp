@@ -15,6 +15,7 @@
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 #include <unistd.h>
+#include <signal.h>
 #include <iostream>
 
 #include "Controller.h"
@@ -35,12 +36,22 @@ int main(int argc, char *argv[])
 	if (g_Conf.ReadData(argv[1]))
 		return EXIT_FAILURE;
 
+	// SIGUSR1 prints the latency histograms
+	// it's blocked before any thread starts, so only the sigwait() below ever sees it
+	sigset_t sigs;
+	sigemptyset(&sigs);
+	sigaddset(&sigs, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &sigs, nullptr);
+
 	if (g_Cont.Start())
 		return EXIT_FAILURE;
 
 	std::cout << "Hybrid Transcoder version 0.1.0 successfully started" << std::endl;
 
-	pause();
+	// anything else that isn't ignored ends tcd, like pause() did
+	int sig;
+	while (0 == sigwait(&sigs, &sig))
+		g_Cont.ReportLatency(std::cout);
 
 	g_Cont.Stop();
 
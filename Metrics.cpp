@@ -0,0 +1,173 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "Metrics.h"
+
+void CMetrics::Family(const char *name, const char *type, const char *help)
+{
+	os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type << '\n';
+}
+
+void CMetrics::Sample(const char *name, const std::string &labels, uint64_t value)
+{
+	os << name;
+	if (! labels.empty())
+		os << '{' << labels << '}';
+	os << ' ' << value << '\n';
+}
+
+void CMetrics::Sample(const char *name, const std::string &labels, double value)
+{
+	os << name;
+	if (! labels.empty())
+		os << '{' << labels << '}';
+	os << ' ' << value << '\n';
+}
+
+std::string CMetrics::Label(const char *name, const std::string &value)
+{
+	std::string s(name);
+	s.append("=\"");
+	for (auto c : value)
+	{
+		if ('\\' == c || '"' == c)
+			s.push_back('\\');
+		if ('\n' == c)
+			s.append("\\n");
+		else
+			s.push_back(c);
+	}
+	s.push_back('"');
+	return s;
+}
+
+bool CMetricsServer::Start(uint16_t port, std::function<void(CMetrics &)> collect)
+{
+	listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+	{
+		std::cerr << "Could not open a socket for the metrics: " << strerror(errno) << std::endl;
+		return true;
+	}
+	int yes = 1;
+	setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, 4))
+	{
+		std::cerr << "Could not listen for metrics on 127.0.0.1:" << port << ": " << strerror(errno) << std::endl;
+		close(listen_fd);
+		listen_fd = -1;
+		return true;
+	}
+	collector = collect;
+	keep_running = true;
+	future = std::async(std::launch::async, &CMetricsServer::Run, this);
+	std::cout << "Metrics are at http://127.0.0.1:" << port << "/metrics" << std::endl;
+	return false;
+}
+
+void CMetricsServer::Stop()
+{
+	keep_running = false;
+	if (future.valid())
+		future.get();
+	if (listen_fd >= 0)
+	{
+		close(listen_fd);
+		listen_fd = -1;
+	}
+}
+
+void CMetricsServer::Run()
+{
+	while (keep_running)
+	{
+		pollfd pfd { listen_fd, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		const int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0)
+			continue;
+		Serve(fd);
+		close(fd);
+	}
+}
+
+// a minimal HTTP/1.0 server, it only has the one page
+void CMetricsServer::Serve(int fd)
+{
+	struct timeval tv { 1, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	// read the request header
+	std::string request;
+	char buf[1024];
+	while (std::string::npos == request.find("\r\n\r\n") && request.size() < 8192)
+	{
+		const auto n = recv(fd, buf, sizeof(buf), 0);
+		if (n <= 0)
+			return;
+		request.append(buf, std::size_t(n));
+	}
+
+	std::string status("200 OK"), body;
+	if (0 == request.compare(0, 13, "GET /metrics ") || 0 == request.compare(0, 6, "GET / "))
+	{
+		std::ostringstream os;
+		CMetrics metrics(os);
+		collector(metrics);
+		body = os.str();
+	}
+	else
+	{
+		status.assign("404 Not Found");
+		body.assign("Only /metrics is here\n");
+	}
+
+	std::ostringstream response;
+	response << "HTTP/1.0 " << status << "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n\r\n" << body;
+	const auto s = response.str();
+	const char *data = s.data();
+	std::size_t size = s.size();
+	while (size)
+	{
+		const auto n = send(fd, data, size, MSG_NOSIGNAL);
+		if (n <= 0)
+		{
+			if (n < 0 && EINTR == errno)
+				continue;
+			return;
+		}
+		data += n;
+		size -= std::size_t(n);
+	}
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+#include <atomic>
+#include <future>
+#include <functional>
+
+// writes metrics in the Prometheus text format
+// each family has to be started before its samples, and all of its samples come together
+class CMetrics
+{
+public:
+	CMetrics(std::ostream &o) : os(o) {}
+
+	// type is counter, gauge or summary
+	void Family(const char *name, const char *type, const char *help);
+	// labels is like: module="A",path="dstar", or empty
+	void Sample(const char *name, const std::string &labels, uint64_t value);
+	void Sample(const char *name, const std::string &labels, double value);
+
+	// a label, with its value escaped
+	static std::string Label(const char *name, const std::string &value);
+
+private:
+	std::ostream &os;
+};
+
+// serves the metrics over HTTP on a local port, for Prometheus or curl
+// one request at a time, on its own thread, so a slow client can't hold up transcoding
+class CMetricsServer
+{
+public:
+	~CMetricsServer() { Stop(); }
+
+	// only listens on the loopback address, returns true on failure
+	bool Start(uint16_t port, std::function<void(CMetrics &)> collect);
+	void Stop();
+
+private:
+	void Run();
+	void Serve(int fd);
+
+	int listen_fd = -1;
+	std::atomic<bool> keep_running { false };
+	std::future<void> future;
+	std::function<void(CMetrics &)> collector;
+};
@@ -0,0 +1,88 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <iostream>
+
+#include "PacketPool.h"
+
+CPacketPool::CPacketPool() : capacity(0), in_use(0), high_water(0), misses(0) {}
+
+bool CPacketPool::Init(std::size_t modules)
+{
+	if (blocks)
+	{
+		std::cerr << "The packet pool is already initialized" << std::endl;
+		return true;
+	}
+
+	capacity = modules * packets_per_module;
+	if (0 == capacity || capacity > max_packets)
+	{
+		std::cerr << "Can't make a packet pool for " << modules << " modules" << std::endl;
+		capacity = 0;
+		return true;
+	}
+
+	blocks = std::unique_ptr<SBlock[]>(new SBlock[capacity]);
+	for (std::size_t i=0; i<capacity; i++)
+		free_list.push(&blocks[i]);
+
+	std::cout << "Packet pool has room for " << capacity << " packets" << std::endl;
+	return false;
+}
+
+std::shared_ptr<CTranscoderPacket> CPacketPool::NewPacket(const STCPacket &tcp)
+{
+	return std::allocate_shared<CTranscoderPacket>(CAllocator<CTranscoderPacket>(this), tcp);
+}
+
+void *CPacketPool::Get()
+{
+	void *p;
+	if (free_list.try_pop(p))
+	{
+		const auto n = ++in_use;
+		auto hw = high_water.load(std::memory_order_relaxed);
+		while (n > hw && ! high_water.compare_exchange_weak(hw, n, std::memory_order_relaxed))
+			;
+		return p;
+	}
+
+	// the pool is empty (or was never initialized)
+	misses++;
+	return ::operator new(sizeof(SBlock));
+}
+
+void CPacketPool::Put(void *p)
+{
+	if (IsPooled(p))
+	{
+		in_use--;
+		free_list.push(p);
+	}
+	else
+	{
+		::operator delete(p);
+	}
+}
+
+bool CPacketPool::IsPooled(const void *p) const
+{
+	if (! blocks)
+		return false;
+	auto b = static_cast<const SBlock *>(p);
+	return b >= &blocks[0] && b < &blocks[0] + capacity;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+
+#include "RingQueue.h"
+#include "TranscoderPacket.h"
+
+// a fixed capacity pool of CTranscoderPackets
+// NewPacket() uses std::allocate_shared, so the packet and its shared_ptr control block
+// share one pool block and that block goes back to the pool when the last stage lets
+// go of the packet. nothing else in the pipeline has to know where a packet came from.
+// if the pool is ever empty, the packet comes from the heap and that is counted as a miss
+class CPacketPool
+{
+public:
+	// 64 packets is more than a second of audio for each module
+	static constexpr std::size_t packets_per_module = 64;
+	// there can't be more than 26 modules
+	static constexpr std::size_t max_packets = 26 * packets_per_module;
+
+	CPacketPool();
+	bool Init(std::size_t modules);
+	std::shared_ptr<CTranscoderPacket> NewPacket(const STCPacket &tcp);
+
+	// counters for sizing the pool
+	std::size_t Capacity()  const { return capacity; }
+	std::size_t InUse()     const { return in_use; }
+	std::size_t HighWater() const { return high_water; }
+	std::size_t Misses()    const { return misses; }
+
+	template <typename U> class CAllocator
+	{
+	public:
+		using value_type = U;
+
+		explicit CAllocator(CPacketPool *p) : pool(p) {}
+		template <typename V> CAllocator(const CAllocator<V> &other) : pool(other.pool) {}
+
+		U *allocate(std::size_t n)
+		{
+			static_assert(sizeof(U) <= block_size, "a pool block is too small for a shared CTranscoderPacket");
+			static_assert(alignof(U) <= alignof(SBlock), "a pool block is not aligned for a shared CTranscoderPacket");
+			if (1 != n)
+				throw std::bad_alloc();
+			return static_cast<U *>(pool->Get());
+		}
+
+		void deallocate(U *p, std::size_t)
+		{
+			pool->Put(p);
+		}
+
+		template <typename V> bool operator==(const CAllocator<V> &other) const { return pool == other.pool; }
+		template <typename V> bool operator!=(const CAllocator<V> &other) const { return pool != other.pool; }
+
+		CPacketPool *pool;
+	};
+
+private:
+	// room for the packet and the shared_ptr control block around it
+	static constexpr std::size_t block_size = sizeof(CTranscoderPacket) + 64;
+	struct alignas(std::max_align_t) SBlock
+	{
+		unsigned char data[block_size];
+	};
+
+	void *Get();
+	void Put(void *p);
+	bool IsPooled(const void *p) const;
+
+	std::unique_ptr<SBlock[]> blocks;
+	std::size_t capacity;
+	CRingQueue<void *, 2048> free_list;
+	std::atomic<std::size_t> in_use, high_water, misses;
+
+	static_assert(max_packets <= 2048, "the free list is too small for the pool");
+};
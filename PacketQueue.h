@@ -18,71 +18,13 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 #include <memory>
 
+#include "RingQueue.h"
 #include "TranscoderPacket.h"
 
 // for holding CTranscoder packets while the vocoders are working their magic
-// thread safe
-class CPacketQueue
-{
-public:
-	CPacketQueue() : keep_running(true) {}
-
-	std::shared_ptr<CTranscoderPacket> pop()
-	{
-		std::shared_ptr<CTranscoderPacket> rval;	// the return value
-
-		std::unique_lock<std::mutex> lock(mx);
-
-		while (keep_running && q.empty())
-			cv.wait(lock);
-
-		if (keep_running)
-		{
-			rval = q.front();
-			q.pop();
-		}
-		else
-		{
-			while (! q.empty())
-				q.pop();
-		}
-
-		return rval;
-	}
-
-	std::size_t push(std::shared_ptr<CTranscoderPacket> item)
-	{
-		std::unique_lock<std::mutex> lock(mx);
-		bool was_empty = q.empty();
-		q.push(item);
-
-		if (was_empty)
-			cv.notify_one();
-
-		return q.size();
-	}
-
-	bool IsEmpty()
-	{
-		std::lock_guard<std::mutex> lock(mx);
-		return q.empty();
-	}
-
-	void Shutdown()
-	{
-		std::lock_guard<std::mutex> lock(mx);
-		keep_running = false;
-		cv.notify_all();
-	}
-
-private:
-	std::mutex mx;
-	std::condition_variable cv;
-	std::queue<std::shared_ptr<CTranscoderPacket>> q;
-	std::atomic<bool> keep_running;
-};
+// thread safe, bounded and lock-free, see RingQueue.h
+// at 50 packets per second per module, there is room for more than 5 seconds
+// of backlog for a single module, so a full queue means something is stuck
+using CPacketQueue = CRingQueue<std::shared_ptr<CTranscoderPacket>, 256>;
@@ -0,0 +1,297 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+enum class EQueueStatus { ok, full, closed };
+
+// a bounded, preallocated ring queue (D. Vyukov's sequenced cells)
+// any number of threads may push, and pop is safe from any thread, but only
+// a single consumer may block in pop() at a time (SPSC and MPSC usage)
+// push never blocks and never allocates, a full queue is reported to the caller
+// a blocking consumer spins for a little while before it parks on the condition
+// variable, and a producer only takes the mutex to wake the consumer if it has
+// actually parked, so a busy pipeline never touches the futex
+template <typename TItem, std::size_t QSIZE>
+class CRingQueue
+{
+	static_assert(QSIZE >= 2 && 0 == (QSIZE & (QSIZE - 1)), "CRingQueue size must be a power of two");
+
+public:
+	CRingQueue() : head(0), tail(0), high_water(0), parked(false), kicked(false), keep_running(true)
+	{
+		for (std::size_t i=0; i<QSIZE; i++)
+			cells[i].seq.store(i, std::memory_order_relaxed);
+	}
+
+	CRingQueue(const CRingQueue &) = delete;
+	CRingQueue &operator=(const CRingQueue &) = delete;
+
+	// returns EQueueStatus::full if there is no room, the item is not queued
+	EQueueStatus push(TItem item)
+	{
+		if (! keep_running)
+			return EQueueStatus::closed;
+
+		auto pos = tail.load(std::memory_order_relaxed);
+		SCell *cell;
+		while (true)
+		{
+			cell = &cells[pos & (QSIZE - 1)];
+			const auto seq = cell->seq.load(std::memory_order_acquire);
+			const auto diff = intptr_t(seq) - intptr_t(pos);
+			if (0 == diff)
+			{
+				if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return EQueueStatus::full;
+			}
+			else
+			{
+				pos = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		cell->item = std::move(item);
+		cell->seq.store(pos + 1, std::memory_order_release);
+
+		// the deepest the queue has been, it's only for the metrics, so it needn't be exact
+		const auto depth = pos + 1 - head.load(std::memory_order_relaxed);
+		auto high = high_water.load(std::memory_order_relaxed);
+		while (depth > high && depth <= QSIZE && ! high_water.compare_exchange_weak(high, depth, std::memory_order_relaxed))
+			;
+
+		wake();
+		return EQueueStatus::ok;
+	}
+
+	// never blocks, returns false if there was nothing to pop
+	bool try_pop(TItem &item)
+	{
+		auto pos = head.load(std::memory_order_relaxed);
+		SCell *cell;
+		while (true)
+		{
+			cell = &cells[pos & (QSIZE - 1)];
+			const auto seq = cell->seq.load(std::memory_order_acquire);
+			const auto diff = intptr_t(seq) - intptr_t(pos + 1);
+			if (0 == diff)
+			{
+				if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = head.load(std::memory_order_relaxed);
+			}
+		}
+
+		item = std::move(cell->item);
+		cell->item = TItem();
+		cell->seq.store(pos + QSIZE, std::memory_order_release);
+		return true;
+	}
+
+	// blocks until there is something to pop, unless shutting down
+	// returns an empty TItem when shutting down
+	TItem pop()
+	{
+		TItem item;
+		wait_pop(item, nullptr);
+		return item;
+	}
+
+	// like pop(), but also returns an empty TItem if nothing arrives within the timeout,
+	// or if Notify() was called while waiting
+	TItem pop(std::chrono::milliseconds timeout)
+	{
+		TItem item;
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		wait_pop(item, &deadline);
+		return item;
+	}
+
+	// waits up to the timeout for at least one item, then takes everything
+	// else that is already queued, up to max items; returns the number popped
+	std::size_t pop_batch(TItem *items, std::size_t max, std::chrono::milliseconds timeout)
+	{
+		if (0 == max)
+			return 0;
+
+		const auto deadline = std::chrono::steady_clock::now() + timeout;
+		if (! wait_pop(items[0], &deadline))
+			return 0;
+
+		std::size_t count = 1;
+		while (count < max && try_pop(items[count]))
+			count++;
+
+		return count;
+	}
+
+	// wakes a blocked consumer without pushing anything
+	// if the consumer isn't blocked, its next wait returns immediately
+	void Notify()
+	{
+		kicked.store(true, std::memory_order_relaxed);
+		wake();
+	}
+
+	bool IsEmpty() const
+	{
+		return 0 == Size();
+	}
+
+	std::size_t Size() const
+	{
+		const auto t = tail.load(std::memory_order_relaxed);
+		const auto h = head.load(std::memory_order_relaxed);
+		return (t > h) ? t - h : 0;
+	}
+
+	constexpr std::size_t Capacity() const { return QSIZE; }
+
+	// the most items that have been in the queue at once
+	std::size_t HighWater() const { return high_water.load(std::memory_order_relaxed); }
+
+	void Shutdown()
+	{
+		std::lock_guard<std::mutex> lock(mx);
+		keep_running = false;
+		cv.notify_all();
+	}
+
+private:
+	struct SCell
+	{
+		std::atomic<std::size_t> seq;
+		TItem item;
+	};
+
+	// spinning only makes sense if the producer can run while we spin
+	static unsigned spin_limit()
+	{
+		static const unsigned limit = (std::thread::hardware_concurrency() > 1) ? 128u : 0u;
+		return limit;
+	}
+
+	static inline void cpu_relax()
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+		asm volatile("yield" ::: "memory");
+#endif
+	}
+
+	void wake()
+	{
+		// pairs with the fence in wait_pop(), either we see the consumer is parked,
+		// or the consumer sees what we just did before it goes to sleep
+		// only the first producer to see it parked pays for the wake up
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (parked.load(std::memory_order_relaxed) && parked.exchange(false, std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(mx);
+			cv.notify_one();
+		}
+	}
+
+	bool was_kicked()
+	{
+		return kicked.load(std::memory_order_relaxed) && kicked.exchange(false, std::memory_order_relaxed);
+	}
+
+	// returns true if an item was popped
+	bool wait_pop(TItem &item, const std::chrono::steady_clock::time_point *deadline)
+	{
+		if (! keep_running)
+		{
+			while (try_pop(item))
+				;	// drain
+			item = TItem();
+			return false;
+		}
+
+		if (try_pop(item))
+			return true;
+
+		const auto spins = spin_limit();
+		for (unsigned i=0; i<spins; i++)
+		{
+			cpu_relax();
+			if (try_pop(item))
+				return true;
+			if (was_kicked())
+				return false;
+		}
+
+		std::unique_lock<std::mutex> lock(mx);
+		while (keep_running)
+		{
+			parked.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (try_pop(item))
+			{
+				parked.store(false, std::memory_order_relaxed);
+				return true;
+			}
+			if (was_kicked())
+				break;
+
+			if (deadline)
+			{
+				if (std::cv_status::timeout == cv.wait_until(lock, *deadline))
+				{
+					parked.store(false, std::memory_order_relaxed);
+					return try_pop(item);
+				}
+			}
+			else
+			{
+				cv.wait(lock);
+			}
+		}
+		parked.store(false, std::memory_order_relaxed);
+		return false;
+	}
+
+	SCell cells[QSIZE];
+	alignas(64) std::atomic<std::size_t> head;
+	alignas(64) std::atomic<std::size_t> tail;
+	std::atomic<std::size_t> high_water;
+	alignas(64) std::atomic<bool> parked;
+	std::atomic<bool> kicked;
+	std::atomic<bool> keep_running;
+	std::mutex mx;
+	std::condition_variable cv;
+};
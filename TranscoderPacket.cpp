@@ -16,11 +16,16 @@
 
 #include <arpa/inet.h>
 #include <iostream>
+#include <cstring>
+#include <chrono>
 
 #include "TranscoderPacket.h"
+#include "ByteSwap.h"
 
 CTranscoderPacket::CTranscoderPacket(const STCPacket &tcp) : dstar_set(false), dmr_set(false), p25_set(false), m17_set(false), usrp_set(false), not_sent(true)
 {
+	memset(stamps, 0, sizeof(stamps));
+	Stamp(EStage::received);
 	tcpacket.module = tcp.module;
 	tcpacket.is_last = tcp.is_last;
 	tcpacket.streamid = tcp.streamid;
@@ -88,24 +93,28 @@ const STCPacket *CTranscoderPacket::GetTCPacket() const
 void CTranscoderPacket::SetM17Data(const uint8_t *data)
 {
 	memcpy(tcpacket.m17, data, 16);
+	Stamp(EStage::m17);
 	m17_set = true;
 }
 
 void CTranscoderPacket::SetDStarData(const uint8_t *dstar)
 {
 	memcpy(tcpacket.dstar, dstar, 9);
+	Stamp(EStage::dstar);
 	dstar_set = true;
 }
 
 void CTranscoderPacket::SetDMRData(const uint8_t *dmr)
 {
 	memcpy(tcpacket.dmr, dmr, 9);
+	Stamp(EStage::dmr);
 	dmr_set = true;
 }
 
 void CTranscoderPacket::SetP25Data(const uint8_t *p25)
 {
 	memcpy(tcpacket.p25, p25, 11);
+	Stamp(EStage::p25);
 	p25_set = true;
 }
 
@@ -114,13 +123,40 @@ void CTranscoderPacket::SetUSRPData(const int16_t *usrp)
 	for(int i = 0; i < 160; ++i){
 		tcpacket.usrp[i] = usrp[i];
 	}
+	Stamp(EStage::usrp);
+	usrp_set = true;
+}
+
+void CTranscoderPacket::SetUSRPData(const int16_t *usrp, const CAudioGain &gain)
+{
+	gain.Apply(tcpacket.usrp, usrp, 160);
+	Stamp(EStage::usrp);
 	usrp_set = true;
 }
 
 void CTranscoderPacket::SetAudioSamples(const int16_t *sample, bool swap)
 {
-	for (unsigned int i=0; i<160; i++)
-		audio[i] = swap ? ntohs(sample[i]) : sample[i];
+	if (swap)
+		SwapBytes16(audio, sample, 160);	// straight from the device's receive buffer
+	else
+		memcpy(audio, sample, sizeof(audio));
+	Stamp(EStage::decoded);
+}
+
+void CTranscoderPacket::SetAudioSamples(const int16_t *sample, const CAudioGain &gain)
+{
+	gain.Apply(audio, sample, 160);
+	Stamp(EStage::decoded);
+}
+
+void CTranscoderPacket::Stamp(EStage stage)
+{
+	stamps[int(stage)] = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t CTranscoderPacket::GetStamp(EStage stage) const
+{
+	return stamps[int(stage)];
 }
 
 const int16_t *CTranscoderPacket::GetAudioSamples() const
@@ -183,12 +219,9 @@ bool CTranscoderPacket::AllCodecsAreSet() const
 	return (dstar_set && dmr_set && m17_set && p25_set && usrp_set);
 }
 
-void CTranscoderPacket::Sent()
-{
-	not_sent = false;
-}
-
-bool CTranscoderPacket::HasNotBeenSent() const
+// returns true if all codecs are set and the packet hasn't already been claimed for sending
+// only the first caller gets true, so whichever stage finishes the packet last sends it, exactly once
+bool CTranscoderPacket::ReadyToSend()
 {
-	return not_sent;
+	return AllCodecsAreSet() && not_sent.exchange(false);
 }
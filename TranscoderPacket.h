@@ -22,6 +22,11 @@
 #include <atomic>
 
 #include "TCPacketDef.h"
+#include "AudioGain.h"
+
+// the stages of a packet's trip through tcd, each one is timestamped for the latency histograms
+// the queued stages are when it was handed to a DVSI device or to a software vocoder's queue
+enum class EStage { received, dstar_queued, dmr_queued, codec2_queued, imbe_queued, usrp_queued, swambe2_queued, decoded, dstar, dmr, m17, p25, usrp, sent, count };
 
 class CTranscoderPacket
 {
@@ -43,7 +48,9 @@ public:
 	void SetP25Data(const uint8_t *p25);
 	void SetM17Data(const uint8_t *m17);
 	void SetUSRPData(const int16_t *usrp);
+	void SetUSRPData(const int16_t *usrp, const CAudioGain &gain);
 	void SetAudioSamples(const int16_t *samples, bool swap);
+	void SetAudioSamples(const int16_t *samples, const CAudioGain &gain);
 
 	// audio
 	const int16_t *GetAudioSamples() const;
@@ -60,14 +67,19 @@ public:
 	bool M17IsSet() const;
 	bool USRPIsSet() const;
 	bool AllCodecsAreSet() const;
-	void Sent();
-	bool HasNotBeenSent() const;
+	bool ReadyToSend();
 
 	// the all important packet
 	const STCPacket *GetTCPacket() const;
 
+	// latency timestamps, steady_clock nanoseconds, or 0 for a stage the packet didn't reach
+	// each stage is stamped by only one thread, and before the codec flag that hands the packet on
+	void Stamp(EStage stage);
+	int64_t GetStamp(EStage stage) const;
+
 private:
 	STCPacket tcpacket;
 	int16_t audio[160];
+	int64_t stamps[int(EStage::count)];
 	std::atomic_bool dstar_set, dmr_set, p25_set, m17_set, usrp_set, not_sent;
 };
@@ -0,0 +1,374 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// Codec2 benchmark
+// times codec2_encode and codec2_decode in 3200 and 1600 modes, then each of the hot
+// stages on its own: the inputs of every 10 ms analysis frame are captured from a real
+// encode and decode of the audio first, so each stage sees what it sees in the codec.
+// every test is run reps times and the best and the median nanoseconds per call are
+// reported, as CSV or, with -j, JSON, so runs from different commits can be compared.
+// the check column is a hash of the encoded bits and decoded audio, or for synthesise_high,
+// which raises the pitch so synthesise() uses its oscillator bank, of the synthesised
+// audio. it changes if the output does, and -d writes that output to a file, frame by frame, for a closer look
+// usage: codec2bench [-s seconds | -i raw_audio] [-r reps] [-l label] [-j] [-d dump_file]
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "../codec2/codec2.h"
+#include "SynthSpeech.h"
+
+extern CKissFFT kiss;
+
+struct SResult
+{
+	std::string stage;
+	std::size_t calls;
+	double best, median;	// nanoseconds per call
+	std::string check;
+};
+
+// the inputs to each stage for one 10 ms analysis frame
+struct SFrame
+{
+	std::vector<float> Sn;	// the m_pitch sample analysis window
+	std::complex<float> Sw[FFT_ENC];
+	MODEL pitch;	// the nlp pitch estimate
+	MODEL model;	// refined, with amplitudes
+	float ak[LPC_ORD+1];
+	float lsps[LPC_ORD];
+	float e;
+	MODEL synth;	// decoded, with phases, ready to synthesise
+};
+
+static uint64_t Hash(uint64_t h, const void *data, std::size_t size)
+{
+	// FNV-1a
+	auto p = static_cast<const uint8_t *>(data);
+	for (std::size_t i=0; i<size; i++)
+		h = (h ^ p[i]) * 0x100000001b3ull;
+	return h;
+}
+
+static std::string Hex(uint64_t h)
+{
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << h;
+	return ss.str();
+}
+
+// runs test reps times, each time making calls calls
+static SResult Time(const std::string &stage, std::size_t calls, unsigned reps, const std::function<void()> &test)
+{
+	std::vector<double> ns;
+	for (unsigned r=0; r<reps; r++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		test();
+		ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(calls));
+	}
+	std::sort(ns.begin(), ns.end());
+	return SResult { stage, calls, ns.front(), ns[ns.size() / 2], "" };
+}
+
+// the stages are private, this is a friend of CCodec2 and CQuantize
+class CCodec2Bench
+{
+public:
+	CCodec2Bench(const std::vector<int16_t> &a, unsigned r, std::ofstream &d) : audio(a), reps(r), dump(d) {}
+
+	void Codec(bool is_3200, std::vector<SResult> &results)
+	{
+		const std::string mode(is_3200 ? "3200" : "1600");
+		const std::size_t samples = is_3200 ? 160 : 320;
+		const std::size_t frames = audio.size() / samples;
+		std::vector<unsigned char> bits(8 * frames);
+		std::vector<short> pcm(samples * frames);
+
+		// a new codec each time, so every rep has the same output
+		uint64_t h = 0xcbf29ce484222325ull;
+		auto encode = Time("encode_" + mode, frames, reps, [&]() {
+			CCodec2 c2(is_3200);
+			for (std::size_t f=0; f<frames; f++)
+				c2.codec2_encode(bits.data() + 8 * f, audio.data() + samples * f);
+		});
+		auto decode = Time("decode_" + mode, frames, reps, [&]() {
+			CCodec2 c2(is_3200);
+			for (std::size_t f=0; f<frames; f++)
+				c2.codec2_decode(pcm.data() + samples * f, bits.data() + 8 * f);
+		});
+		h = Hash(h, bits.data(), bits.size());
+		encode.check = Hex(h);
+		decode.check = Hex(Hash(h, pcm.data(), pcm.size() * sizeof(short)));
+		results.push_back(encode);
+		results.push_back(decode);
+
+		if (dump.is_open())
+		{
+			for (std::size_t f=0; f<frames; f++)
+			{
+				dump.write(reinterpret_cast<const char *>(bits.data() + 8 * f), 8);
+				dump.write(reinterpret_cast<const char *>(pcm.data() + samples * f), samples * sizeof(short));
+			}
+		}
+	}
+
+	void Stages(std::vector<SResult> &results)
+	{
+		CCodec2 c2(true);
+		auto &c = c2.c2;
+		const int n_samp = c.n_samp, m_pitch = c.m_pitch;
+		Capture(c2);
+		const std::size_t n = frames.size();
+
+		// the stateful ones get a new codec each rep, like the codec does
+		std::size_t f;
+		results.push_back(Time("nlp", n, reps, [&]() {
+			CCodec2 fresh(true);
+			float pitch;
+			for (auto &fr : frames)
+				fresh.nlp.nlp(fr.Sn.data(), n_samp, &pitch, &fresh.c2.prev_f0_enc);
+		}));
+		results.push_back(Time("dft_speech", n, reps, [&]() {
+			std::complex<float> Sw[FFT_ENC];
+			for (auto &fr : frames)
+				c2.dft_speech(&c.c2const, c.fft_fwd_cfg, Sw, fr.Sn.data(), c.w.data());
+		}));
+		results.push_back(Time("two_stage_pitch_refinement", n, reps, [&]() {
+			MODEL model;
+			for (auto &fr : frames)
+			{
+				model.Wo = fr.pitch.Wo;
+				model.L = fr.pitch.L;
+				c2.two_stage_pitch_refinement(&c.c2const, &model, fr.Sw);
+			}
+		}));
+		results.push_back(Time("est_voicing_mbe", n, reps, [&]() {
+			for (auto &fr : frames)
+			{
+				MODEL model = fr.model;
+				c2.est_voicing_mbe(&c.c2const, &model, fr.Sw, c.W);
+			}
+		}));
+		results.push_back(Time("speech_to_uq_lsps", n, reps, [&]() {
+			float lsps[LPC_ORD], ak[LPC_ORD+1];
+			for (auto &fr : frames)
+				c2.qt.speech_to_uq_lsps(lsps, ak, fr.Sn.data(), c.w.data(), m_pitch, LPC_ORD);
+		}));
+		results.push_back(Time("lpc_to_lsp", n, reps, [&]() {
+			float lsps[LPC_ORD];
+			for (auto &fr : frames)
+				c2.qt.lpc_to_lsp(fr.ak, LPC_ORD, lsps, 5, 0.01);
+		}));
+		results.push_back(Time("encode_lspds_scalar", n, reps, [&]() {
+			int indexes[LPC_ORD];
+			for (auto &fr : frames)
+				c2.qt.encode_lspds_scalar(indexes, fr.lsps, LPC_ORD);
+		}));
+		results.push_back(Time("encode_lsps_scalar", n, reps, [&]() {
+			int indexes[LPC_ORD];
+			for (auto &fr : frames)
+				c2.qt.encode_lsps_scalar(indexes, fr.lsps, LPC_ORD);
+		}));
+		results.push_back(Time("aks_to_M2", n, reps, [&]() {
+			std::complex<float> Aw[FFT_ENC];
+			float snr;
+			for (auto &fr : frames)
+			{
+				MODEL model = fr.model;
+				c2.qt.aks_to_M2(&c.fftr_fwd_cfg, fr.ak, LPC_ORD, &model, fr.e, &snr, 0, c.lpc_pf, c.bass_boost, c.beta, c.gamma, Aw);
+			}
+		}));
+		results.push_back(Time("synthesise", n, reps, [&]() {
+			for (auto &fr : frames)
+				c2.synthesise(n_samp, &c.fftr_inv_cfg, c.Sn_.data(), &fr.synth, c.Pn.data(), 1);
+		}));
+
+		// the speech is never pitched high enough for the oscillator bank, so these are the same
+		// frames with 10 to 12 harmonics, and the check is a hash of what's synthesised from them
+		std::vector<MODEL> high(n);
+		for (f=0; f<n; f++)
+		{
+			high[f] = frames[f].synth;
+			high[f].L = SYNTH_BANK_MAX_L - int(f % 3);
+			high[f].Wo = PI / (high[f].L + 0.5f);
+		}
+		std::vector<float> Sn_(2 * n_samp);
+		uint64_t h = 0xcbf29ce484222325ull;
+		for (auto &model : high)
+		{
+			c2.synthesise(n_samp, &c.fftr_inv_cfg, Sn_.data(), &model, c.Pn.data(), 1);
+			h = Hash(h, Sn_.data(), n_samp * sizeof(float));
+		}
+		results.push_back(Time("synthesise_high", n, reps, [&]() {
+			for (auto &model : high)
+				c2.synthesise(n_samp, &c.fftr_inv_cfg, c.Sn_.data(), &model, c.Pn.data(), 1);
+		}));
+		results.back().check = Hex(h);
+
+		// the kiss FFTs at the codec's size, on the speech
+		std::vector<std::complex<float>> out(FFT_ENC);
+		std::vector<float> real(FFT_ENC);
+		results.push_back(Time("kiss_fft_512", n, reps, [&]() {
+			for (f=0; f<n; f++)
+				kiss.fft(c.fft_fwd_cfg, frames[f].Sw, out.data());
+		}));
+		results.push_back(Time("kiss_fftr_512", n, reps, [&]() {
+			for (f=0; f<n; f++)
+			{
+				std::copy(frames[f].Sn.begin(), frames[f].Sn.end(), real.begin());
+				kiss.fftr(c.fftr_fwd_cfg, real.data(), out.data());
+			}
+		}));
+		results.push_back(Time("kiss_fftri_512", n, reps, [&]() {
+			for (f=0; f<n; f++)
+				kiss.fftri(c.fftr_inv_cfg, frames[f].Sw, real.data());
+		}));
+	}
+
+private:
+	// does what analyse_one_frame and the 3200 decoder do, keeping what each stage gets
+	void Capture(CCodec2 &c2)
+	{
+		auto &c = c2.c2;
+		const int n_samp = c.n_samp, m_pitch = c.m_pitch;
+		frames.resize(audio.size() / n_samp);
+		std::complex<float> Aw[FFT_ENC], H[MAX_AMP+1];
+		for (std::size_t f=0; f<frames.size(); f++)
+		{
+			auto &fr = frames[f];
+			for (int i=0; i<m_pitch-n_samp; i++)
+				c.Sn[i] = c.Sn[i+n_samp];
+			for (int i=0; i<n_samp; i++)
+				c.Sn[i+m_pitch-n_samp] = audio[n_samp * f + i];
+			fr.Sn = c.Sn;
+
+			c2.dft_speech(&c.c2const, c.fft_fwd_cfg, fr.Sw, c.Sn.data(), c.w.data());
+			float pitch;
+			c2.nlp.nlp(c.Sn.data(), n_samp, &pitch, &c.prev_f0_enc);
+			fr.pitch.Wo = TWO_PI / pitch;
+			fr.pitch.L = PI / fr.pitch.Wo;
+			fr.model = fr.pitch;
+			c2.two_stage_pitch_refinement(&c.c2const, &fr.model, fr.Sw);
+			c2.estimate_amplitudes(&fr.model, fr.Sw, 0);
+			MODEL voiced = fr.model;
+			c2.est_voicing_mbe(&c.c2const, &voiced, fr.Sw, c.W);
+
+			fr.e = c2.qt.speech_to_uq_lsps(fr.lsps, fr.ak, c.Sn.data(), c.w.data(), m_pitch, LPC_ORD);
+
+			float snr;
+			fr.synth = voiced;
+			c2.qt.aks_to_M2(&c.fftr_fwd_cfg, fr.ak, LPC_ORD, &fr.synth, fr.e, &snr, 0, c.lpc_pf, c.bass_boost, c.beta, c.gamma, Aw);
+			c2.qt.apply_lpc_correction(&fr.synth);
+			c2.sample_phase(&fr.synth, H, Aw);
+			c2.phase_synth_zero_order(n_samp, &fr.synth, &c.ex_phase, H);
+			c2.postfilter(&fr.synth, &c.bg_est);
+		}
+	}
+
+	const std::vector<int16_t> &audio;
+	const unsigned reps;
+	std::ofstream &dump;
+	std::vector<SFrame> frames;
+};
+
+int main(int argc, char *argv[])
+{
+	unsigned seconds = 10, reps = 5;
+	const char *input = nullptr;
+	std::string label, dump_file;
+	bool json = false;
+	int opt;
+	while (-1 != (opt = getopt(argc, argv, "s:i:r:l:jd:")))
+	{
+		switch (opt)
+		{
+		case 's': seconds = unsigned(atoi(optarg)); break;
+		case 'i': input = optarg; break;
+		case 'r': reps = unsigned(atoi(optarg)); break;
+		case 'l': label.assign(optarg); break;
+		case 'j': json = true; break;
+		case 'd': dump_file.assign(optarg); break;
+		default: seconds = 0; break;
+		}
+	}
+	if (optind != argc || seconds < 1 || reps < 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [-s seconds | -i raw_audio] [-r reps] [-l label] [-j] [-d dump_file]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<int16_t> audio;
+	if (CSynthSpeech::Load(input, audio, seconds))
+		return EXIT_FAILURE;
+	// whole 40 ms frames, for 1600
+	audio.resize(audio.size() / 320 * 320);
+	if (audio.empty())
+	{
+		std::cerr << "There isn't 40 ms of audio" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream dump;
+	if (! dump_file.empty())
+	{
+		dump.open(dump_file, std::ios::binary);
+		if (! dump.is_open())
+		{
+			std::cerr << "Can't open " << dump_file << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+
+	std::vector<SResult> results;
+	CCodec2Bench bench(audio, reps, dump);
+	bench.Codec(true, results);
+	bench.Codec(false, results);
+	bench.Stages(results);
+
+	std::cout << std::fixed << std::setprecision(1);
+	if (json)
+	{
+		std::cout << "{\"label\": \"" << label << "\", \"audio_seconds\": " << double(audio.size()) / 8000.0 << ", \"reps\": " << reps << ", \"results\": [" << std::endl;
+		for (std::size_t i=0; i<results.size(); i++)
+		{
+			const auto &r = results[i];
+			std::cout << "  {\"stage\": \"" << r.stage << "\", \"calls\": " << r.calls << ", \"best_ns\": " << r.best << ", \"median_ns\": " << r.median;
+			if (! r.check.empty())
+				std::cout << ", \"check\": \"" << r.check << "\"";
+			std::cout << '}' << ((i + 1 < results.size()) ? "," : "") << std::endl;
+		}
+		std::cout << "]}" << std::endl;
+	}
+	else
+	{
+		std::cout << "label,stage,calls,best_ns,median_ns,check" << std::endl;
+		for (const auto &r : results)
+			std::cout << label << ',' << r.stage << ',' << r.calls << ',' << r.best << ',' << r.median << ',' << r.check << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,205 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// DVSI device load test, with a simulated DV3003 in place of the hardware
+// the frames go through the real feed and read threads of CDVDevice, over a socketpair to
+// a CDVSimulator, as fast as the channel credits allow. half are speech frames to encode and
+// half are ambe frames to decode, spread over the three channels, and every answer is
+// checked against the simulator's stand-in data. a simulated device with faults will lose
+// and damage some answers, and that is counted, not treated as a failure, but the frames
+// that never come back have to time out and give their credits back, or it is a failure.
+// late_percent holds up a channel for half a second, so an answer comes back after its
+// frame has timed out. the channel has to be resynced, and if any answer goes to the wrong
+// frame, that is a failure
+// usage: devicebench [frames [latency_us [baudrate [fault_percent [late_percent]]]]]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+#include "../DVStandIn.h"
+#include "../DVSIFrame.h"
+#include "../Configure.h"
+#include "SynthSpeech.h"
+
+CConfigure g_Conf;	// CDVDevice gets its channel depth from this
+
+static int16_t audio[160];
+static uint8_t expected_ambe[9], ambe_in[9];
+static std::atomic<long> done { 0 }, bad { 0 }, chan_done[3];
+
+// a DV3003, except that it checks the frames that come back instead of routing them
+class CBenchDevice : public CDVDevice
+{
+public:
+	CBenchDevice(Encoding t) : CDVDevice(t) {}
+
+protected:
+	unsigned int FormatAudio(uint8_t *buf, const uint8_t channel, const int16_t *samples) const override
+	{
+		return WriteSpeechFrame(buf, channel, samples);
+	}
+	unsigned int FormatData(uint8_t *buf, const uint8_t channel, const uint8_t *data) const override
+	{
+		return WriteChannelFrame(buf, channel, data);
+	}
+	void ProcessPacket(const SDV_Packet &p) override
+	{
+		Encoding encoding;
+		const unsigned int channel = p.field_id - PKT_CHANNEL0;
+		auto packet = PopWaitingPacket(channel, encoding);
+		if (! packet)
+			return;
+		bool ok;
+		if (PKT_CHANNEL == p.header.packet_type)
+		{
+			// this was a speech frame, so it's the checksum of the audio
+			ok = (0 == memcmp(p.payload.ambe.data, expected_ambe, 9)) && (0 == packet->GetTCPacket()->sequence % 2);
+		}
+		else
+		{
+			packet->SetAudioSamples(p.payload.audio.samples, true);
+			ok = (1 == packet->GetTCPacket()->sequence % 2);
+			const int16_t *samples = packet->GetAudioSamples();
+			for (unsigned int i=0; ok && i<160; i++)
+				ok = (samples[i] == int16_t((ambe_in[i % 9] << 8) | i));
+		}
+		if (! ok)
+			bad++;
+		chan_done[channel]++;
+		done++;
+	}
+};
+
+int main(int argc, char *argv[])
+{
+	const long frames = (argc > 1) ? atol(argv[1]) : 30000;
+	SSimOptions options;
+	options.latency  = (argc > 2) ? unsigned(atol(argv[2])) : 0u;
+	options.baudrate = (argc > 3) ? unsigned(atol(argv[3])) : 921600u;
+	options.fault_rate = (argc > 4) ? atof(argv[4]) / 100.0 : 0.0;
+	options.late_rate = (argc > 5) ? atof(argv[5]) / 100.0 : 0.0;
+	if (frames < 1 || options.fault_rate < 0.0 || options.fault_rate > 1.0 || options.late_rate < 0.0 || options.late_rate > 1.0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [frames [latency_us [baudrate [fault_percent [late_percent]]]]]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	CSynthSpeech synth;
+	synth.Next(audio, 160);
+	// the ambe the simulator makes is a checksum of the audio as it is on the wire
+	for (unsigned int i=0; i<160; i++)
+	{
+		expected_ambe[(2 * i) % 9] ^= uint8_t(uint16_t(audio[i]) >> 8);
+		expected_ambe[(2 * i + 1) % 9] ^= uint8_t(audio[i]);
+	}
+	for (unsigned int i=0; i<9; i++)
+		ambe_in[i] = uint8_t(0x11 * (i + 1));
+
+	CDVStandIn<CBenchDevice> device(Encoding::dstar, Edvtype::dv3003, options);
+	if (device.OpenDevice("SIM", "USB-3003", Edvtype::dv3003, 0, 0))
+		return EXIT_FAILURE;
+	device.Start();
+
+	// the frames that came back, and the ones the device gave up on
+	auto finished = [&device](long &timeouts) {
+		timeouts = 0;
+		for (unsigned int ch=0; ch<3; ch++)
+			timeouts += long(device.GetChannelStats(ch).timeouts);
+		return done + timeouts;
+	};
+
+	// even frames are speech to encode, odd frames are ambe to decode
+	const auto start = std::chrono::steady_clock::now();
+	auto last_progress = start;
+	long sent = 0, timeouts = 0, last_finished = 0, chan_sent[3] { 0, 0, 0 };
+	while (finished(timeouts) < sent || sent < frames)
+	{
+		// keep plenty queued, without filling the channels' pending queues
+		while (sent < frames && chan_sent[sent % 3] - chan_done[sent % 3] - long(device.GetChannelStats(unsigned(sent % 3)).timeouts) < 128)
+		{
+			STCPacket tcp;
+			memset(&tcp, 0, sizeof(tcp));
+			tcp.module = 'A';
+			tcp.streamid = 1;
+			tcp.sequence = uint32_t(sent);
+			if (sent % 2)
+			{
+				tcp.codec_in = ECodecType::dstar;
+				memcpy(tcp.dstar, ambe_in, 9);
+			}
+			else
+			{
+				tcp.codec_in = ECodecType::usrp;
+			}
+			auto packet = std::make_shared<CTranscoderPacket>(tcp);
+			if (0 == sent % 2)
+				packet->SetAudioSamples(audio, false);
+			device.AddPacket(packet, unsigned(sent % 3));
+			chan_sent[sent % 3]++;
+			sent++;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+		// lost answers time out, so if nothing has happened for a while, a channel is stuck
+		const auto now = std::chrono::steady_clock::now();
+		const long n = finished(timeouts);
+		if (n != last_finished)
+		{
+			last_finished = n;
+			last_progress = now;
+		}
+		else if (now - last_progress > std::chrono::seconds(2))
+		{
+			break;
+		}
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	unsigned int in_flight = 0;
+	for (unsigned int ch=0; ch<3; ch++)
+		in_flight += device.GetChannelStats(ch).in_flight;
+	finished(timeouts);
+	device.ReportStats();
+	device.CloseDevice();
+
+	std::cout << std::fixed << std::setprecision(0);
+	std::cout << done << " of " << sent << " frames came back, " << timeouts << " timed out, " << bad << " were wrong, " << done / elapsed.count() << " frames/s" << std::endl;
+	if (in_flight || done + timeouts != sent || sent != frames)
+	{
+		std::cerr << "Device check FAILED, " << in_flight << " credits were never given back, " << frames - sent << " frames were never sent" << std::endl;
+		return EXIT_FAILURE;
+	}
+	// only a damaged answer can be wrong, anything else went to the wrong frame
+	if (options.fault_rate > 0.0)
+		return EXIT_SUCCESS;
+	if (bad)
+	{
+		std::cerr << "Device check FAILED, " << bad << " answers went to the wrong frame" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (done != frames && 0.0 == options.late_rate)
+	{
+		std::cerr << "Device check FAILED" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Device check passed" << std::endl;
+	return EXIT_SUCCESS;
+}
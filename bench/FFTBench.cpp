@@ -0,0 +1,291 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// FFT benchmark
+// checks the fixed size FFTs in codec2/fixed_fft.h against the generic kiss FFT and
+// against a DFT done in double precision, for the complex, real and inverse real
+// transforms of the codec's size, on random data and on windows of speech.
+// the error is the largest difference from the DFT over the RMS of the DFT, for each
+// test, and the exit status is a failure if any fixed FFT is worse than the tolerance.
+// then synthesise()'s oscillator bank is checked against the inverse real FFT it stands
+// in for, for every number of harmonics it's used for, over the samples the overlap add
+// reads, relative to their peak, and it's a failure if that's worse than the bank tolerance
+// usage: fftbench [-s seconds | -i raw_audio] [-r reps] [-t tolerance] [-b bank_tolerance]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <complex>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
+
+#include "../codec2/kiss_fft.h"
+#include "../codec2/codec2.h"
+#include "SynthSpeech.h"
+
+static constexpr int nfft = FFT_ENC;
+
+using CFrame = std::vector<std::complex<float>>;
+
+// the reference, an unscaled DFT, like kiss, in double precision
+static std::vector<std::complex<double>> DFT(const CFrame &in, bool inverse)
+{
+	std::vector<std::complex<double>> out(nfft);
+	const double sign = inverse ? 1.0 : -1.0;
+	for (int k=0; k<nfft; k++)
+	{
+		std::complex<double> sum(0.0, 0.0);
+		for (int n=0; n<nfft; n++)
+			sum += std::complex<double>(in[n]) * std::polar(1.0, sign * 2.0 * M_PI * double((k * n) % nfft) / nfft);
+		out[k] = sum;
+	}
+	return out;
+}
+
+// the largest error relative to the RMS of the reference
+static double Error(const std::complex<float> *out, const std::vector<std::complex<double>> &ref, int n)
+{
+	double max = 0.0, power = 0.0;
+	for (int i=0; i<n; i++)
+	{
+		max = std::max(max, std::abs(std::complex<double>(out[i]) - ref[i]));
+		power += std::norm(ref[i]);
+	}
+	return power > 0.0 ? max / std::sqrt(power / n) : max;
+}
+
+// best nanoseconds per transform over reps runs of every frame
+static double Time(std::size_t calls, unsigned reps, const std::function<void()> &test)
+{
+	double best = 1e30;
+	for (unsigned r=0; r<reps; r++)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		test();
+		best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / double(calls));
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned seconds = 5, reps = 5;
+	double tolerance = 1e-5, bank_tolerance = 1.5e-6;
+	const char *input = nullptr;
+	int opt;
+	while (-1 != (opt = getopt(argc, argv, "s:i:r:t:b:")))
+	{
+		switch (opt)
+		{
+		case 's': seconds = unsigned(atoi(optarg)); break;
+		case 'i': input = optarg; break;
+		case 'r': reps = unsigned(atoi(optarg)); break;
+		case 't': tolerance = atof(optarg); break;
+		case 'b': bank_tolerance = atof(optarg); break;
+		default: seconds = 0; break;
+		}
+	}
+	if (optind != argc || seconds < 1 || reps < 1 || tolerance <= 0.0 || bank_tolerance <= 0.0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [-s seconds | -i raw_audio] [-r reps] [-t tolerance] [-b bank_tolerance]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<int16_t> audio;
+	if (CSynthSpeech::Load(input, audio, seconds))
+		return EXIT_FAILURE;
+
+	// the test frames, random complex and real, then real speech, a window every 10 ms
+	std::vector<CFrame> frames;
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	for (int f=0; f<50; f++)
+	{
+		CFrame frame(nfft);
+		for (auto &c : frame)
+			c = std::complex<float>(uniform(rng), f < 25 ? uniform(rng) : 0.0f);
+		frames.push_back(frame);
+	}
+	const std::size_t nrandom = frames.size();
+	for (std::size_t start=0; start+nfft<=audio.size(); start+=80)
+	{
+		CFrame frame(nfft);
+		for (int n=0; n<nfft; n++)
+			frame[n] = float(audio[start + n]) * float(0.5 - 0.5 * std::cos(2.0 * M_PI * n / (nfft - 1)));
+		frames.push_back(frame);
+	}
+	if (frames.size() == nrandom)
+	{
+		std::cerr << "There isn't enough audio for an FFT" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	CKissFFT fixed, generic(false);
+	FFT_STATE fwd, inv;
+	FFTR_STATE rfwd, rinv;
+	generic.fft_alloc(fwd, nfft, false);
+	generic.fft_alloc(inv, nfft, true);
+	generic.fftr_alloc(rfwd, nfft, false);
+	generic.fftr_alloc(rinv, nfft, true);
+
+	// the real frames, and their spectra, for the real transforms
+	std::vector<std::vector<float>> real;
+	std::vector<CFrame> spectra;
+	for (std::size_t f=nrandom/2; f<frames.size(); f++)
+	{
+		std::vector<float> r(nfft);
+		for (int n=0; n<nfft; n++)
+			r[n] = frames[f][n].real();
+		real.push_back(r);
+		CFrame s(nfft/2+1);
+		generic.fftr(rfwd, r.data(), s.data());
+		spectra.push_back(s);
+	}
+
+	// the errors, fixed and generic, against the DFT
+	double err[4][2] {};
+	CFrame out(nfft);
+	std::vector<float> tout(nfft);
+	for (const auto &frame : frames)
+	{
+		const auto ref = DFT(frame, false);
+		fixed.fft(fwd, frame.data(), out.data());
+		err[0][0] = std::max(err[0][0], Error(out.data(), ref, nfft));
+		generic.fft(fwd, frame.data(), out.data());
+		err[0][1] = std::max(err[0][1], Error(out.data(), ref, nfft));
+
+		const auto iref = DFT(frame, true);
+		fixed.fft(inv, frame.data(), out.data());
+		err[1][0] = std::max(err[1][0], Error(out.data(), iref, nfft));
+		generic.fft(inv, frame.data(), out.data());
+		err[1][1] = std::max(err[1][1], Error(out.data(), iref, nfft));
+	}
+	for (std::size_t f=0; f<real.size(); f++)
+	{
+		CFrame in(nfft);
+		for (int n=0; n<nfft; n++)
+			in[n] = real[f][n];
+		const auto ref = DFT(in, false);
+		fixed.fftr(rfwd, real[f].data(), out.data());
+		err[2][0] = std::max(err[2][0], Error(out.data(), ref, nfft/2+1));
+		generic.fftr(rfwd, real[f].data(), out.data());
+		err[2][1] = std::max(err[2][1], Error(out.data(), ref, nfft/2+1));
+
+		// the whole hermitian spectrum, for the inverse
+		for (int k=0; k<=nfft/2; k++)
+			in[k] = spectra[f][k];
+		in[0].imag(0.0f);
+		in[nfft/2].imag(0.0f);
+		for (int k=1; k<nfft/2; k++)
+			in[nfft-k] = std::conj(in[k]);
+		const auto iref = DFT(in, true);
+		CFrame tc(nfft);
+		fixed.fftri(rinv, spectra[f].data(), tout.data());
+		std::transform(tout.begin(), tout.end(), tc.begin(), [](float x) { return std::complex<float>(x); });
+		err[3][0] = std::max(err[3][0], Error(tc.data(), iref, nfft));
+		generic.fftri(rinv, spectra[f].data(), tout.data());
+		std::transform(tout.begin(), tout.end(), tc.begin(), [](float x) { return std::complex<float>(x); });
+		err[3][1] = std::max(err[3][1], Error(tc.data(), iref, nfft));
+	}
+
+	// the timing, each kind of FFT over all of its frames
+	double ns[4][2] {};
+	for (int g=0; g<2; g++)
+	{
+		auto &kiss = g ? generic : fixed;
+		ns[0][g] = Time(frames.size(), reps, [&]() { for (const auto &frame : frames) kiss.fft(fwd, frame.data(), out.data()); });
+		ns[1][g] = Time(frames.size(), reps, [&]() { for (const auto &frame : frames) kiss.fft(inv, frame.data(), out.data()); });
+		ns[2][g] = Time(real.size(), reps, [&]() { for (const auto &r : real) kiss.fftr(rfwd, r.data(), out.data()); });
+		ns[3][g] = Time(spectra.size(), reps, [&]() { for (const auto &s : spectra) kiss.fftri(rinv, s.data(), tout.data()); });
+	}
+
+	const char *names[4] { "fft", "ifft", "fftr", "fftri" };
+	bool failed = false;
+	std::cout << "transform,fixed_error,generic_error,fixed_ns,generic_ns" << std::endl;
+	for (int t=0; t<4; t++)
+	{
+		std::cout << names[t] << '_' << nfft << ',' << std::setprecision(3) << err[t][0] << ',' << err[t][1] << ',' << std::fixed << std::setprecision(1) << ns[t][0] << ',' << ns[t][1] << std::defaultfloat << std::endl;
+		if (err[t][0] > tolerance)
+		{
+			std::cerr << "The fixed " << names[t] << " error is more than " << tolerance << std::endl;
+			failed = true;
+		}
+	}
+
+	// the oscillator bank, on harmonics of a random pitch with nh harmonics below FFT_DEC/2,
+	// with random amplitudes and phases, placed on the bins the way synthesise() does it
+	constexpr int n_samp = 80;	// 10 ms at 8 kHz
+	constexpr int trials = 200;
+	FFTR_STATE dec;
+	fixed.fftr_alloc(dec, FFT_DEC, true);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	std::cout << "harmonics,bank_error,bank_ns,fftri_ns" << std::endl;
+	for (int nh=1; nh<=SYNTH_BANK_MAX_L; nh++)
+	{
+		std::vector<std::vector<int>> bins(trials, std::vector<int>(nh));
+		std::vector<std::vector<std::complex<float>>> X(trials, std::vector<std::complex<float>>(nh));
+		for (int t=0; t<trials; t++)
+		{
+			const float Wo = float(M_PI) / (nh + unit(rng));
+			for (int l=0; l<nh; l++)
+			{
+				bins[t][l] = std::min(int((l + 1) * Wo * FFT_DEC / float(2.0 * M_PI) + 0.5f), FFT_DEC/2 - 1);
+				X[t][l] = std::polar(1000.0f * unit(rng), float(2.0 * M_PI) * unit(rng));
+			}
+		}
+
+		std::vector<float> bank(FFT_DEC), ref(FFT_DEC);
+		CFrame Sw(FFT_DEC/2+1);
+		auto fftri = [&](int t) {
+			std::fill(Sw.begin(), Sw.end(), std::complex<float>(0.0f, 0.0f));
+			for (int l=0; l<nh; l++)
+				Sw[bins[t][l]] = X[t][l];
+			fixed.fftri(dec, Sw.data(), ref.data());
+		};
+
+		double err = 0.0;
+		for (int t=0; t<trials; t++)
+		{
+			fftri(t);
+			oscillator_bank(n_samp, bank.data(), bins[t].data(), X[t].data(), nh);
+			// sw_[FFT_DEC-n_samp+1] to sw_[FFT_DEC-1], then sw_[0] to sw_[n_samp]
+			double max = 0.0, peak = 0.0;
+			for (int i=FFT_DEC-n_samp+1; i<FFT_DEC+n_samp+1; i++)
+			{
+				const int j = i % FFT_DEC;
+				max = std::max(max, std::fabs(double(bank[j]) - ref[j]));
+				peak = std::max(peak, std::fabs(double(ref[j])));
+			}
+			err = std::max(err, peak > 0.0 ? max / peak : max);
+		}
+
+		const double bank_ns = Time(trials, reps, [&]() { for (int t=0; t<trials; t++) oscillator_bank(n_samp, bank.data(), bins[t].data(), X[t].data(), nh); });
+		const double fftri_ns = Time(trials, reps, [&]() { for (int t=0; t<trials; t++) fftri(t); });
+		std::cout << nh << ',' << std::setprecision(3) << err << ',' << std::fixed << std::setprecision(1) << bank_ns << ',' << fftri_ns << std::defaultfloat << std::endl;
+		if (err > bank_tolerance)
+		{
+			std::cerr << "The oscillator bank error for " << nh << " harmonics is more than " << bank_tolerance << std::endl;
+			failed = true;
+		}
+	}
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
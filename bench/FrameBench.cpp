@@ -0,0 +1,133 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// DVSI speech frame encode and decode benchmark
+// the old way built an SDV_Packet on the stack, htons()ed each sample and copied the
+// packet to the transmit buffer, and ntohs()ed each received sample. the new way writes
+// the frame in place with SwapBytes16(). every byte swap version this CPU can run is
+// checked against the old way and timed on its own
+// usage: framebench [frames]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <netinet/in.h>
+
+#include "../DVSIFrame.h"
+#include "SynthSpeech.h"
+
+static int16_t audio[160];
+alignas(64) static uint8_t txbuf[3 * MAX_CHANNEL_DEPTH * sizeof(SDV_Packet)];
+static int16_t decoded[160];
+static volatile unsigned sink;
+
+static unsigned int OldWriteSpeechFrame(uint8_t *buf, uint8_t channel, const int16_t *samples)
+{
+	SDV_Packet p;
+	p.start_byte = PKT_HEADER;
+	p.header.payload_length = htons(1 + sizeof(p.payload.audio));
+	p.header.packet_type = PKT_SPEECH;
+	p.field_id = channel + PKT_CHANNEL0;
+	p.payload.audio.speechd = PKT_SPEECHD;
+	p.payload.audio.num_samples = 160U;
+	for (int i=0; i<160; i++)
+		p.payload.audio.samples[i] = htons(samples[i]);
+	const unsigned int size = packet_size(p);
+	memcpy(buf, &p, size);
+	return size;
+}
+
+static void OldReadSpeechSamples(int16_t *out, const SDV_Packet &p)
+{
+	for (unsigned int i=0; i<160; i++)
+		out[i] = ntohs(p.payload.audio.samples[i]);
+}
+
+// what CTranscoderPacket::SetAudioSamples(..., true) does with a received speech frame
+static void ReadSpeechSamples(int16_t *out, const SDV_Packet &p)
+{
+	SwapBytes16(out, p.payload.audio.samples, 160);
+}
+
+template <typename TFunc> static double Time(long frames, TFunc func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (long f=0; f<frames; f++)
+	{
+		func(f);
+		sink += txbuf[f % 64] + unsigned(decoded[f % 160]);
+	}
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return frames / elapsed.count();
+}
+
+int main(int argc, char *argv[])
+{
+	const long frames = (argc > 1) ? atol(argv[1]) : 5000000;
+	if (frames < 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [frames]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	CSynthSpeech synth;
+	synth.Next(audio, 160);
+
+	// the check, at every offset, so unaligned loads and stores are covered
+	uint8_t expect[sizeof(SDV_Packet)];
+	OldWriteSpeechFrame(expect, 1, audio);
+	for (const auto &impl : SwapBytes16Impls())
+	{
+		for (unsigned int offset=0; offset<32; offset++)
+		{
+			impl.swap(txbuf + offset, audio, 160);
+			int16_t back[160];
+			impl.swap(back, txbuf + offset, 160);
+			if (memcmp(txbuf + offset, expect + 7, 320) || memcmp(back, audio, 320))
+			{
+				std::cerr << impl.name << " byte swap FAILED at offset " << offset << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	if (speech_size != WriteSpeechFrame(txbuf, 1, audio) || memcmp(txbuf, expect, speech_size))
+	{
+		std::cerr << "WriteSpeechFrame() FAILED" << std::endl;
+		return EXIT_FAILURE;
+	}
+	std::cout << "Frame check passed, SwapBytes16() is using " << SwapBytes16Name() << std::endl;
+
+	// the benchmark, one DV3003 frame per channel at a time, like the feeder
+	std::cout << std::setw(28) << "" << std::setw(16) << "frames/s" << std::endl;
+	auto show = [](const char *what, double fps)
+	{
+		std::cout << std::setw(28) << what << std::fixed << std::setprecision(0) << std::setw(16) << fps << std::endl;
+	};
+	show("encode, old", Time(frames, [](long f) { OldWriteSpeechFrame(txbuf + speech_size * (f % 3), f % 3, audio); }));
+	show("encode, in place", Time(frames, [](long f) { WriteSpeechFrame(txbuf + speech_size * (f % 3), f % 3, audio); }));
+	auto p = reinterpret_cast<const SDV_Packet *>(txbuf);
+	show("decode, old", Time(frames, [p](long) { OldReadSpeechSamples(decoded, *p); }));
+	show("decode, in place", Time(frames, [p](long) { ReadSpeechSamples(decoded, *p); }));
+	for (const auto &impl : SwapBytes16Impls())
+	{
+		const std::string name = std::string("160 sample swap, ") + impl.name;
+		auto swap = impl.swap;
+		show(name.c_str(), Time(frames, [swap](long f) { swap(txbuf + 7 + (f & 1), audio, 160); }));
+	}
+
+	return EXIT_SUCCESS;
+}
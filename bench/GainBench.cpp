@@ -0,0 +1,138 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// audio gain check and benchmark
+// first a check: every version CAudioGain can run on this CPU is given every possible
+// sample at every gain from -24 to +24 dB, at every alignment, and has to clip exactly
+// like a plain saturating multiply and shift. then the frame throughput of each version
+// and of the old wrapping loop
+// usage: gainbench [frames]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../AudioGain.h"
+#include "SynthSpeech.h"
+
+static volatile int sink;
+
+static int16_t Expected(int16_t s, int32_t num)
+{
+	const int32_t v = (int32_t(s) * num) >> 8;
+	return int16_t((v > INT16_MAX) ? INT16_MAX : ((v < INT16_MIN) ? INT16_MIN : v));
+}
+
+static bool Check()
+{
+	// every sample, with a few extra so the SIMD loops have a scalar tail
+	std::vector<int16_t> in(65536 + 8 + 7), out(in.size());
+	for (std::size_t i=0; i<in.size(); i++)
+		in[i] = int16_t(i - 32768);
+
+	for (int db=-24; db<=24; db++)
+	{
+		const CAudioGain gain(db);
+		for (const auto &impl : CAudioGain::Impls())
+		{
+			for (std::size_t offset=0; offset<8; offset++)
+			{
+				const std::size_t count = in.size() - offset;
+				impl.apply(out.data() + offset, in.data() + offset, count, gain.Numerator());
+				for (std::size_t i=offset; i<in.size(); i++)
+				{
+					if (out[i] != Expected(in[i], gain.Numerator()))
+					{
+						std::cerr << impl.name << " FAILED at " << db << " dB, offset " << offset << ": " << in[i] << " became " << out[i] << std::endl;
+						return true;
+					}
+				}
+			}
+		}
+	}
+
+	// and the things that used to go wrong
+	const CAudioGain loud(12);
+	int16_t s[4] { INT16_MAX, INT16_MIN, 10000, -10000 }, d[4];
+	loud.Apply(d, s, 4);
+	if (d[0] != INT16_MAX || d[1] != INT16_MIN || d[2] != INT16_MAX || d[3] != INT16_MIN)
+	{
+		std::cerr << "+12 dB didn't clip: " << d[0] << ' ' << d[1] << ' ' << d[2] << ' ' << d[3] << std::endl;
+		return true;
+	}
+	// in place
+	const CAudioGain quiet(-6);
+	quiet.Apply(s, s, 4);
+	if (s[0] != Expected(INT16_MAX, quiet.Numerator()) || s[3] != Expected(-10000, quiet.Numerator()))
+	{
+		std::cerr << "-6 dB in place FAILED" << std::endl;
+		return true;
+	}
+	return false;
+}
+
+template <typename TFunc> static double Time(long frames, TFunc func)
+{
+	const auto start = std::chrono::steady_clock::now();
+	for (long f=0; f<frames; f++)
+		func(f);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return frames / elapsed.count();
+}
+
+int main(int argc, char *argv[])
+{
+	const long frames = (argc > 1) ? atol(argv[1]) : 5000000;
+	if (frames < 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [frames]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	if (Check())
+		return EXIT_FAILURE;
+	std::cout << "Gain check passed, CAudioGain is using " << CAudioGain::ImplName() << std::endl;
+
+	static int16_t audio[8 * 160], out[160];
+	CSynthSpeech synth;
+	synth.Next(audio, 8 * 160);
+	const CAudioGain gain(12);
+
+	auto show = [](const std::string &what, double fps)
+	{
+		std::cout << std::setw(20) << what << std::fixed << std::setprecision(0) << std::setw(16) << fps << std::endl;
+	};
+	std::cout << std::setw(20) << "160 sample frames" << std::setw(16) << "frames/s" << std::endl;
+	show("old, wraps", Time(frames, [&](long f) {
+		const int16_t *p = audio + 160 * (f & 7);
+		for (int i=0; i<160; i++)
+			out[i] = int16_t((p[i] * gain.Numerator()) >> 8);
+		sink += out[f % 160];
+	}));
+	for (const auto &impl : CAudioGain::Impls())
+	{
+		auto apply = impl.apply;
+		show(impl.name, Time(frames, [&](long f) {
+			apply(out, audio + 160 * (f & 7), 160, gain.Numerator());
+			sink += out[f % 160];
+		}));
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// multi-module P25 benchmark
+// each module encodes and decodes its own stream on its own thread, first with
+// a vocoder pair for each module (what tcd does now), then with one vocoder pair
+// shared behind a mutex (what tcd used to do)
+// usage: p25bench [max_modules [seconds_of_audio]]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <imbe_vocoder_api.h>
+
+#include "SynthSpeech.h"
+
+static std::vector<int16_t> audio;
+
+// returns frames per second, summed over all modules
+static double Run(unsigned modules, bool shared)
+{
+	std::mutex mux;
+	imbe_vocoder shared_enc, shared_dec;
+	std::vector<std::thread> threads;
+	const unsigned frames = unsigned(audio.size() / 160);
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned m=0; m<modules; m++)
+	{
+		threads.emplace_back([&]() {
+			std::unique_ptr<imbe_vocoder> enc, dec;
+			if (! shared)
+			{
+				enc.reset(new imbe_vocoder);
+				dec.reset(new imbe_vocoder);
+			}
+			uint8_t imbe[11];
+			int16_t pcm[160];
+			for (unsigned f=0; f<frames; f++)
+			{
+				if (shared)
+				{
+					std::lock_guard<std::mutex> lock(mux);
+					shared_enc.encode_4400(audio.data() + 160 * f, imbe);
+					shared_dec.decode_4400(pcm, imbe);
+				}
+				else
+				{
+					enc->encode_4400(audio.data() + 160 * f, imbe);
+					dec->decode_4400(pcm, imbe);
+				}
+			}
+		});
+	}
+	for (auto &t : threads)
+		t.join();
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return modules * frames / elapsed.count();
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned max_modules = (argc > 1) ? unsigned(atoi(argv[1])) : std::max(1u, std::thread::hardware_concurrency());
+	const unsigned seconds = (argc > 2) ? unsigned(atoi(argv[2])) : 10u;
+	if (max_modules < 1 || max_modules > 26 || seconds < 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [max_modules [seconds_of_audio]]" << std::endl;
+		return EXIT_FAILURE;
+	}
+	CSynthSpeech::Load(nullptr, audio, seconds);
+
+	std::cout << "P25 encode+decode, " << seconds << " seconds of audio per module, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+	std::cout << std::setw(8) << "modules" << std::setw(16) << "per-module fps" << std::setw(10) << "scaling" << std::setw(16) << "shared fps" << std::setw(10) << "scaling" << std::endl;
+	double base_own = 0.0, base_shared = 0.0;
+	for (unsigned m=1; m<=max_modules; m++)
+	{
+		const double own = Run(m, false);
+		const double shared = Run(m, true);
+		if (1 == m)
+		{
+			base_own = own;
+			base_shared = shared;
+		}
+		std::cout << std::fixed << std::setprecision(0) << std::setw(8) << m << std::setw(16) << own << std::setprecision(2) << std::setw(9) << own / base_own << 'x'
+			<< std::setprecision(0) << std::setw(16) << shared << std::setprecision(2) << std::setw(9) << shared / base_shared << 'x' << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// DVSI receive parser check and benchmark
+// first a check: a stream of ambe, audio and control packets, with some junk in front of
+// it, is fed to the parser in pieces of random size, so packets are split and merged at
+// every kind of boundary, and every packet has to come out whole and in order.
+// then the time it takes to parse, for a few read sizes.
+// usage: parserbench [packets]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <netinet/in.h>
+
+#include "../DVSIParser.h"
+
+// a packet like the device sends, with its payload filled with random bytes
+static void MakePacket(std::mt19937 &rng, std::vector<uint8_t> &stream, std::vector<std::size_t> &sizes)
+{
+	static const uint16_t lengths[] { 12, 323, 16, 2 };	// ambe, audio, config response, ready
+	static const uint8_t types[] { PKT_CHANNEL, PKT_SPEECH, PKT_CONTROL, PKT_CONTROL };
+	const auto i = rng() % 4;
+	stream.push_back(PKT_HEADER);
+	stream.push_back(lengths[i] >> 8);
+	stream.push_back(lengths[i] & 0xffu);
+	stream.push_back(types[i]);
+	for (unsigned n=0; n<lengths[i]; n++)
+		stream.push_back(uint8_t(rng()));
+	sizes.push_back(4u + lengths[i]);
+}
+
+// feeds the stream in pieces no bigger than max_piece (random sizes if random is set)
+// returns the number of packets that came out, or -1 if one didn't match
+static long Feed(CDVSIParser &parser, const std::vector<uint8_t> &stream, const std::vector<std::size_t> *sizes, std::size_t skip, std::size_t max_piece, bool random, std::mt19937 &rng)
+{
+	std::size_t in = 0, out = skip;
+	long count = 0;
+	while (in < stream.size())
+	{
+		std::size_t room;
+		auto buf = parser.Space(room);
+		std::size_t piece = random ? 1 + rng() % max_piece : max_piece;
+		piece = std::min(piece, std::min(room, stream.size() - in));
+		memcpy(buf, stream.data() + in, piece);
+		parser.Commit(piece);
+		in += piece;
+
+		const SDV_Packet *p;
+		while (nullptr != (p = parser.Next()))
+		{
+			const std::size_t size = packet_size(*p);
+			if (sizes && (size != (*sizes)[count] || memcmp(p, stream.data() + out, size)))
+			{
+				std::cerr << "Packet " << count << " at stream offset " << out << " doesn't match" << std::endl;
+				return -1;
+			}
+			out += size;
+			count++;
+		}
+	}
+	return count;
+}
+
+int main(int argc, char *argv[])
+{
+	const long packets = (argc > 1) ? atol(argv[1]) : 200000;
+	if (packets < 1)
+	{
+		std::cerr << "Usage: " << argv[0] << " [packets]" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::mt19937 rng(1);
+	std::vector<uint8_t> stream;
+	std::vector<std::size_t> sizes;
+	// junk before the first packet, without a start byte in it
+	const std::size_t junk = 37;
+	for (std::size_t i=0; i<junk; i++)
+		stream.push_back(uint8_t(i));
+	for (long i=0; i<packets; i++)
+		MakePacket(rng, stream, sizes);
+
+	// the check
+	for (std::size_t max_piece : { std::size_t(1), std::size_t(5), std::size_t(17), std::size_t(400), std::size_t(USB3XXX_MAXPACKETSIZE) })
+	{
+		CDVSIParser parser;
+		if (packets != Feed(parser, stream, &sizes, junk, max_piece, true, rng) || junk != parser.Discarded())
+		{
+			std::cerr << "FAILED with pieces of 1 to " << max_piece << " bytes, " << parser.Discarded() << " bytes discarded" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	std::cout << "Parser check passed: " << packets << " packets split and merged at random boundaries" << std::endl;
+
+	// the benchmark
+	std::cout << std::setw(12) << "read size" << std::setw(16) << "packets/s" << std::setw(12) << "MB/s" << std::endl;
+	for (std::size_t piece : { std::size_t(16), std::size_t(64), std::size_t(384), std::size_t(USB3XXX_MAXPACKETSIZE) })
+	{
+		CDVSIParser parser;
+		const auto start = std::chrono::steady_clock::now();
+		const long count = Feed(parser, stream, nullptr, junk, piece, false, rng);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		std::cout << std::fixed << std::setprecision(0) << std::setw(12) << piece << std::setw(16) << count / elapsed.count()
+			<< std::setprecision(1) << std::setw(12) << stream.size() / elapsed.count() / 1e6 << std::endl;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// micro-benchmark of the lock-free CRingQueue against the mutex + condition_variable
+// + std::queue design that CPacketQueue used to be
+// usage: queuebench [items]
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+
+#include "../RingQueue.h"
+
+using Item = std::shared_ptr<int>;
+
+// this is what CPacketQueue looked like before it was a CRingQueue
+class CMutexQueue
+{
+public:
+	CMutexQueue() : keep_running(true) {}
+
+	Item pop()
+	{
+		Item rval;
+		std::unique_lock<std::mutex> lock(mx);
+		while (keep_running && q.empty())
+			cv.wait(lock);
+		if (keep_running)
+		{
+			rval = q.front();
+			q.pop();
+		}
+		return rval;
+	}
+
+	EQueueStatus push(Item item)
+	{
+		std::unique_lock<std::mutex> lock(mx);
+		bool was_empty = q.empty();
+		q.push(item);
+		if (was_empty)
+			cv.notify_one();
+		return EQueueStatus::ok;
+	}
+
+private:
+	std::mutex mx;
+	std::condition_variable cv;
+	std::queue<Item> q;
+	std::atomic<bool> keep_running;
+};
+
+using CRing = CRingQueue<Item, 256>;
+
+template <typename Q> void Push(Q &q, const Item &item)
+{
+	while (EQueueStatus::full == q.push(item))
+		std::this_thread::yield();
+}
+
+// nproducers threads push items, this thread pops them all
+template <typename Q> double Throughput(unsigned nproducers, unsigned items)
+{
+	Q q;
+	const Item item = std::make_shared<int>(0);
+	const unsigned each = items / nproducers;
+	std::vector<std::thread> producers;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned p=0; p<nproducers; p++)
+		producers.emplace_back([&q, &item, each]() { for (unsigned i=0; i<each; i++) Push(q, item); });
+
+	for (unsigned i=0; i<each*nproducers; i++)
+	{
+		if (! q.pop())
+		{
+			std::cerr << "pop() came back empty" << std::endl;
+			exit(EXIT_FAILURE);
+		}
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+
+	for (auto &t : producers)
+		t.join();
+
+	return elapsed.count() / (each * nproducers);
+}
+
+// one item bounces between two threads, this is the hand-off latency the
+// vocoder threads see when the pipeline is lightly loaded
+template <typename Q> double PingPong(unsigned rounds)
+{
+	Q ping, pong;
+	const Item item = std::make_shared<int>(0);
+
+	std::thread echo([&]() { for (unsigned i=0; i<rounds; i++) Push(pong, ping.pop()); });
+
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned i=0; i<rounds; i++)
+	{
+		Push(ping, item);
+		pong.pop();
+	}
+	const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+	echo.join();
+
+	return elapsed.count() / rounds;
+}
+
+// the vocoder threads don't see a flood, they see a frame every 20 ms per module
+// so this is the round trip when the consumer has had time to park
+template <typename Q> double Parked(unsigned rounds)
+{
+	Q ping, pong;
+	const Item item = std::make_shared<int>(0);
+
+	std::thread echo([&]() { for (unsigned i=0; i<rounds; i++) Push(pong, ping.pop()); });
+
+	double total = 0.0;
+	for (unsigned i=0; i<rounds; i++)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+		const auto start = std::chrono::steady_clock::now();
+		Push(ping, item);
+		pong.pop();
+		const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		total += elapsed.count();
+	}
+	echo.join();
+
+	return total / rounds;
+}
+
+static void Report(const char *test, double mutex_ns, double ring_ns)
+{
+	std::cout << std::left << std::setw(28) << test << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(12) << mutex_ns << std::setw(12) << ring_ns << std::setw(9) << mutex_ns / ring_ns << 'x' << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	const unsigned items = (argc > 1) ? unsigned(atoi(argv[1])) : 1000000u;
+	if (items < 1000u)
+	{
+		std::cerr << "Usage: " << argv[0] << " [items], where items >= 1000" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::cout << std::left << std::setw(28) << "ns per item" << std::right << std::setw(12) << "mutex" << std::setw(12) << "ring" << std::setw(10) << "speedup" << std::endl;
+	Report("throughput, 1 producer", Throughput<CMutexQueue>(1, items), Throughput<CRing>(1, items));
+	Report("throughput, 3 producers", Throughput<CMutexQueue>(3, items), Throughput<CRing>(3, items));
+	Report("ping-pong round trip", PingPong<CMutexQueue>(items / 10), PingPong<CRing>(items / 10));
+	Report("parked round trip", Parked<CMutexQueue>(1000), Parked<CRing>(1000));
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// a repeatable, speech-like 8 kHz test signal for the benchmarks
+// a gliding glottal pulse train through three formant resonators, with unvoiced
+// (noise) segments and pauses, so the vocoders see voiced, unvoiced and silent frames
+class CSynthSpeech
+{
+public:
+	CSynthSpeech(uint32_t seed = 1) : rand_state(seed), n(0), phase(0.0) {}
+
+	void Next(int16_t *out, unsigned count)
+	{
+		for (unsigned i=0; i<count; i++, n++)
+		{
+			// 1.4 second cycle: 900 ms voiced, 200 ms unvoiced, 300 ms silence
+			const unsigned pos = n % 11200u;
+			const double t = double(n) / 8000.0;
+			double excitation = 0.0;
+			if (pos < 7200u)
+			{
+				const double f0 = 140.0 + 40.0 * std::sin(2.0 * M_PI * 0.7 * t);
+				phase += f0 / 8000.0;
+				if (phase >= 1.0)
+				{
+					phase -= 1.0;
+					excitation = 1.0;
+				}
+			}
+			else if (pos < 8800u)
+			{
+				excitation = 0.3 * (Random() - 0.5);
+			}
+
+			// the formants move a little, like a changing vowel
+			const double formants[3] = { 500.0 + 200.0 * std::sin(2.0 * M_PI * 1.3 * t), 1500.0 + 300.0 * std::sin(2.0 * M_PI * 0.9 * t), 2500.0 };
+			double y = excitation;
+			for (int f=0; f<3; f++)
+				y = Resonate(f, y, formants[f], 80.0 + 40.0 * f);
+
+			// the impulses lose most of their energy in the narrow resonators, this puts
+			// the voiced peaks near 7500, about -13 dBFS
+			double s = 3.0e7 * y;
+			if (s > 32767.0)
+				s = 32767.0;
+			else if (s < -32768.0)
+				s = -32768.0;
+			out[i] = int16_t(s);
+		}
+	}
+
+	// read raw 16-bit, 8 kHz, host order audio, or fill with the synthetic signal if path is null
+	// returns true on failure
+	static bool Load(const char *path, std::vector<int16_t> &audio, unsigned seconds)
+	{
+		if (nullptr == path)
+		{
+			audio.resize(8000u * seconds);
+			CSynthSpeech synth;
+			synth.Next(audio.data(), unsigned(audio.size()));
+			return false;
+		}
+
+		auto fp = fopen(path, "rb");
+		if (nullptr == fp)
+		{
+			perror(path);
+			return true;
+		}
+		int16_t buf[160];
+		size_t got;
+		while (160 == (got = fread(buf, sizeof(int16_t), 160, fp)))
+			audio.insert(audio.end(), buf, buf + 160);
+		fclose(fp);
+		if (audio.empty())
+		{
+			fprintf(stderr, "%s doesn't have a whole 20 ms frame of audio\n", path);
+			return true;
+		}
+		return false;
+	}
+
+private:
+	double Random()
+	{
+		rand_state = rand_state * 1103515245u + 12345u;
+		return double((rand_state >> 16) & 0x7fffu) / 32768.0;
+	}
+
+	double Resonate(int f, double x, double freq, double bw)
+	{
+		const double r = std::exp(-M_PI * bw / 8000.0);
+		const double a1 = 2.0 * r * std::cos(2.0 * M_PI * freq / 8000.0);
+		const double a2 = -r * r;
+		const double y = (1.0 - r) * x + a1 * y1[f] + a2 * y2[f];
+		y2[f] = y1[f];
+		y1[f] = y;
+		return y;
+	}
+
+	uint32_t rand_state;
+	unsigned n;
+	double phase;
+	double y1[3] = { 0.0, 0.0, 0.0 };
+	double y2[3] = { 0.0, 0.0, 0.0 };
+};
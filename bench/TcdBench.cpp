@@ -0,0 +1,445 @@
+// tcd - a hybrid transcoder using DVSI hardware and Codec2 software
+// Copyright © 2026 Thomas A. Early N7TAE
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+// tcd end-to-end benchmark
+// a whole transcoder, configured by the ini file, is run against a mock reflector that
+// listens where the ini file says the reflector is. streams of STCPackets, synthetic or
+// recorded, go in one TCP connection per module, like a reflector sends them, and the
+// finished packets are timed when they come back. each input codec gets a phase of its
+// own, then all of them at once on different modules, and each phase reports frames per
+// second, the p50, p99 and p99.9 round-trip latency and the CPU time per frame of
+// everything but the mock reflector. with StandInDevices in the ini file, the simulated
+// DVSI devices are part of that CPU time
+// with -w, the packets that are sent are saved, and -f replays a saved file, each
+// module's packets as one stream, instead of the phases
+// bench/contended.ini has more modules than DVSI channels, so with -c dstar,dmr the
+// mixed phase has both vocoders routing packets, some of them silence, at once
+// usage: tcd-bench [-n frames] [-s streams] [-c codec,codec...] [-x] [-w file | -f file] tcd.ini
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <ctime>
+#include <random>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "../Configure.h"
+#include "../Controller.h"
+#include "SynthSpeech.h"
+
+// the global objects
+CConfigure  g_Conf;
+CController g_Cont;
+
+using Clock = std::chrono::steady_clock;
+
+// the reflector end of the transcoder link
+class CMockReflector
+{
+public:
+	~CMockReflector()
+	{
+		for (auto &m : fds)
+			close(m.second);
+		if (listen_fd >= 0)
+			close(listen_fd);
+	}
+
+	// returns true on failure
+	bool Listen(const std::string &address, uint16_t port)
+	{
+		struct addrinfo hints, *res;
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV | AI_PASSIVE;
+		if (getaddrinfo(address.c_str(), std::to_string(port).c_str(), &hints, &res))
+		{
+			std::cerr << "Bad reflector address " << address << std::endl;
+			return true;
+		}
+		listen_fd = socket(res->ai_family, SOCK_STREAM, 0);
+		int yes = 1;
+		setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+		const bool failed = (listen_fd < 0 || bind(listen_fd, res->ai_addr, res->ai_addrlen) || listen(listen_fd, 26));
+		freeaddrinfo(res);
+		if (failed)
+			std::cerr << "The mock reflector can't listen on " << address << ':' << port << ": " << strerror(errno) << std::endl;
+		return failed;
+	}
+
+	// each module connects and says which module it is
+	bool Accept(const std::string &modules)
+	{
+		while (fds.size() < modules.size())
+		{
+			pollfd pfd { listen_fd, POLLIN, 0 };
+			if (1 != poll(&pfd, 1, 5000))
+			{
+				std::cerr << "tcd didn't connect every module" << std::endl;
+				return true;
+			}
+			const int fd = accept(listen_fd, nullptr, nullptr);
+			char module;
+			if (fd < 0 || 1 != recv(fd, &module, 1, MSG_WAITALL) || std::string::npos == modules.find(module))
+			{
+				std::cerr << "Bad connection from tcd" << std::endl;
+				return true;
+			}
+			int yes = 1;
+			setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+			fds[module] = fd;
+			pfds.push_back({ fd, POLLIN, 0 });
+		}
+		return false;
+	}
+
+	bool Send(const STCPacket &packet)
+	{
+		return sizeof(STCPacket) != send(fds.at(packet.module), &packet, sizeof(STCPacket), MSG_NOSIGNAL);
+	}
+
+	// waits up to timeout for finished packets
+	template <typename TFunc> void Receive(int timeout_ms, TFunc func)
+	{
+		if (poll(pfds.data(), pfds.size(), timeout_ms) <= 0)
+			return;
+		for (auto &pfd : pfds)
+		{
+			if (0 == (pfd.revents & POLLIN))
+				continue;
+			STCPacket packet;
+			if (sizeof(STCPacket) == recv(pfd.fd, &packet, sizeof(STCPacket), MSG_WAITALL))
+				func(packet);
+		}
+	}
+
+private:
+	int listen_fd = -1;
+	std::map<char, int> fds;
+	std::vector<pollfd> pfds;
+};
+
+struct SStream
+{
+	std::vector<STCPacket> packets;
+	std::size_t next = 0, returned = 0;
+};
+
+struct SResult
+{
+	std::string name;
+	std::size_t sent = 0, returned = 0;
+	double seconds = 0.0, cpu = 0.0;
+	std::vector<double> latency;	// milliseconds
+};
+
+static const std::map<std::string, ECodecType> codec_names {
+	{ "dstar", ECodecType::dstar }, { "dmr", ECodecType::dmr }, { "p25", ECodecType::p25 },
+	{ "usrp", ECodecType::usrp }, { "c2_1600", ECodecType::c2_1600 }, { "c2_3200", ECodecType::c2_3200 }
+};
+
+static double CpuSeconds(clockid_t id)
+{
+	timespec ts;
+	clock_gettime(id, &ts);
+	return double(ts.tv_sec) + 1e-9 * double(ts.tv_nsec);
+}
+
+// a synthetic stream of one codec, made from the synthetic speech
+static std::vector<STCPacket> MakeStream(ECodecType codec, std::size_t frames)
+{
+	static uint16_t streamid = 0;
+	std::vector<int16_t> audio;
+	CSynthSpeech::Load(nullptr, audio, unsigned(frames / 50 + 1));
+	std::mt19937 rng { unsigned(codec) };
+	CCodec2 c2_16(false), c2_32(true);
+	imbe_vocoder imbe;
+
+	std::vector<STCPacket> packets(frames);
+	streamid++;
+	for (std::size_t f=0; f<frames; f++)
+	{
+		auto &p = packets[f];
+		memset(&p, 0, sizeof(p));
+		p.streamid = streamid;
+		p.sequence = uint32_t(f);
+		p.is_last = (f + 1 == frames);
+		p.codec_in = codec;
+		const int16_t *samples = audio.data() + 160 * f;
+		switch (codec)
+		{
+		case ECodecType::dstar:
+		case ECodecType::dmr:
+			// there's no software AMBE encoder here, and any bits will do for a vocoder
+			for (auto &b : (ECodecType::dstar == codec) ? p.dstar : p.dmr)
+				b = uint8_t(rng());
+			break;
+		case ECodecType::p25:
+			imbe.encode_4400(const_cast<int16_t *>(samples), p.p25);
+			break;
+		case ECodecType::usrp:
+			memcpy(p.usrp, samples, sizeof(p.usrp));
+			break;
+		case ECodecType::c2_1600:
+		case ECodecType::c2_3200:
+			// an M17 frame is 40 ms, both packets of the pair carry all of it
+			if (0 == f % 2)
+			{
+				if (ECodecType::c2_1600 == codec)
+				{
+					c2_16.codec2_encode(p.m17, samples);
+				}
+				else
+				{
+					c2_32.codec2_encode(p.m17, samples);
+					c2_32.codec2_encode(p.m17 + 8, samples + 160);
+				}
+			}
+			else
+			{
+				memcpy(p.m17, packets[f-1].m17, sizeof(p.m17));
+			}
+			break;
+		default:
+			break;
+		}
+	}
+	return packets;
+}
+
+// sends every stream, one module each, and waits for what comes back
+static SResult RunPhase(CMockReflector &reflector, const std::string &name, std::vector<SStream> &streams, bool flat_out, std::ofstream &record)
+{
+	static constexpr std::size_t window = 8;	// frames each stream can have in flight when flat out
+	SResult result;
+	result.name = name;
+	std::unordered_map<uint64_t, Clock::time_point> in_flight;
+	auto key = [](const STCPacket &p) { return (uint64_t(uint8_t(p.module)) << 48) | (uint64_t(p.streamid) << 32) | p.sequence; };
+	std::map<char, SStream *> by_module;
+	for (auto &s : streams)
+		by_module[s.packets.front().module] = &s;
+
+	const auto start = Clock::now();
+	const double cpu_start = CpuSeconds(CLOCK_PROCESS_CPUTIME_ID), self_start = CpuSeconds(CLOCK_THREAD_CPUTIME_ID);
+	auto last_return = start;
+	for (;;)
+	{
+		// send what's due, each stream starts a little later than the one before it
+		auto now = Clock::now();
+		auto wake = now + std::chrono::milliseconds(100);
+		bool all_sent = true;
+		for (std::size_t i=0; i<streams.size(); i++)
+		{
+			auto &s = streams[i];
+			while (s.next < s.packets.size())
+			{
+				if (flat_out)
+				{
+					if (s.next - s.returned >= window)
+						break;
+				}
+				else
+				{
+					const auto due = start + std::chrono::microseconds(20000 * s.next + 20000 * i / streams.size());
+					if (due > now)
+					{
+						wake = std::min(wake, due);
+						break;
+					}
+				}
+				const auto &p = s.packets[s.next++];
+				in_flight[key(p)] = Clock::now();
+				reflector.Send(p);
+				if (record.is_open())
+					record.write(reinterpret_cast<const char *>(&p), sizeof(p));
+				result.sent++;
+			}
+			if (s.next < s.packets.size())
+				all_sent = false;
+		}
+		if (all_sent && in_flight.empty())
+			break;
+		if (all_sent && now - last_return > std::chrono::seconds(2))
+			break;	// the rest aren't coming back
+
+		const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count();
+		reflector.Receive(int(std::max<long>(0, long(ms))), [&](const STCPacket &p)
+		{
+			const auto t = Clock::now();
+			auto it = in_flight.find(key(p));
+			if (in_flight.end() == it)
+				return;
+			result.latency.push_back(std::chrono::duration<double, std::milli>(t - it->second).count());
+			in_flight.erase(it);
+			result.returned++;
+			by_module.at(p.module)->returned++;
+			last_return = t;
+		});
+	}
+	result.seconds = std::chrono::duration<double>(last_return - start).count();
+	result.cpu = (CpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - cpu_start) - (CpuSeconds(CLOCK_THREAD_CPUTIME_ID) - self_start);
+	return result;
+}
+
+static void Report(const SResult &r)
+{
+	auto latency = r.latency;
+	std::sort(latency.begin(), latency.end());
+	auto pct = [&latency](double p) { return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, std::size_t(p / 100.0 * double(latency.size())))]; };
+	std::cout << std::left << std::setw(16) << r.name << std::right << std::setw(8) << r.sent << std::setw(9) << r.returned << std::fixed << std::setprecision(0) << std::setw(10) << ((r.seconds > 0.0) ? double(r.returned) / r.seconds : 0.0)
+		<< std::setprecision(2) << std::setw(9) << pct(50.0) << std::setw(9) << pct(99.0) << std::setw(9) << pct(99.9) << std::setw(9) << (latency.empty() ? 0.0 : latency.back())
+		<< std::setprecision(1) << std::setw(12) << (r.returned ? 1e6 * r.cpu / double(r.returned) : 0.0) << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	std::size_t frames = 250, nstreams = 0;
+	std::string codecs("dstar,dmr,p25,usrp,c2_1600,c2_3200"), replay, save;
+	bool flat_out = false;
+	int opt;
+	while (-1 != (opt = getopt(argc, argv, "n:s:c:xf:w:")))
+	{
+		switch (opt)
+		{
+		case 'n': frames = std::size_t(atol(optarg)); break;
+		case 's': nstreams = std::size_t(atol(optarg)); break;
+		case 'c': codecs.assign(optarg); break;
+		case 'x': flat_out = true; break;
+		case 'f': replay.assign(optarg); break;
+		case 'w': save.assign(optarg); break;
+		default: optind = argc + 1; break;
+		}
+	}
+	if (optind + 1 != argc || frames < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " [-n frames] [-s streams] [-c codec,codec...] [-x] [-w file | -f file] tcd.ini" << std::endl;
+		std::cerr << "codecs are dstar, dmr, p25, usrp, c2_1600 and c2_3200, -x sends as fast as tcd will take them" << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	std::vector<ECodecType> paths;
+	std::vector<std::string> path_names;
+	std::stringstream ss(codecs);
+	std::string name;
+	while (std::getline(ss, name, ','))
+	{
+		auto it = codec_names.find(name);
+		if (codec_names.end() == it)
+		{
+			std::cerr << "Unknown codec '" << name << "'" << std::endl;
+			return EXIT_FAILURE;
+		}
+		paths.push_back(it->second);
+		path_names.push_back(name);
+	}
+
+	if (g_Conf.ReadData(argv[optind]))
+		return EXIT_FAILURE;
+	const std::string modules(g_Conf.GetTCMods());
+	if (0 == nstreams || nstreams > modules.size())
+		nstreams = modules.size();
+
+	// the reflector has to be there before tcd starts
+	CMockReflector reflector;
+	if (reflector.Listen(g_Conf.GetAddress(), uint16_t(g_Conf.GetPort())))
+		return EXIT_FAILURE;
+	if (g_Cont.Start())
+		return EXIT_FAILURE;
+	if (reflector.Accept(modules))
+	{
+		g_Cont.Stop();
+		return EXIT_FAILURE;
+	}
+
+	std::ofstream record;
+	if (! save.empty())
+		record.open(save, std::ios::binary);
+
+	std::vector<SResult> results;
+	if (replay.empty())
+	{
+		// each path on its own, and then all of them at once
+		for (std::size_t i=0; i<=paths.size(); i++)
+		{
+			if (i == paths.size() && paths.size() < 2)
+				break;
+			std::vector<SStream> streams(nstreams);
+			for (std::size_t s=0; s<nstreams; s++)
+			{
+				streams[s].packets = MakeStream((i < paths.size()) ? paths[i] : paths[s % paths.size()], frames);
+				for (auto &p : streams[s].packets)
+					p.module = modules[s];
+			}
+			const std::string phase = (i < paths.size()) ? path_names[i] + "->all" : std::string("mixed");
+			std::cout << "Running " << phase << " with " << nstreams << " streams of " << frames << " frames" << std::endl;
+			results.push_back(RunPhase(reflector, phase, streams, flat_out, record));
+		}
+	}
+	else
+	{
+		std::ifstream in(replay, std::ios::binary);
+		std::map<char, SStream> by_module;
+		STCPacket p;
+		while (in.read(reinterpret_cast<char *>(&p), sizeof(p)))
+		{
+			if (std::string::npos == modules.find(p.module))
+			{
+				std::cerr << "The recording has module " << p.module << ", which isn't transcoded" << std::endl;
+				g_Cont.Stop();
+				return EXIT_FAILURE;
+			}
+			by_module[p.module].packets.push_back(p);
+		}
+		std::vector<SStream> streams;
+		for (auto &m : by_module)
+			streams.push_back(std::move(m.second));
+		if (streams.empty())
+		{
+			std::cerr << "Nothing to replay in " << replay << std::endl;
+			g_Cont.Stop();
+			return EXIT_FAILURE;
+		}
+		std::cout << "Replaying " << replay << " on " << streams.size() << " modules" << std::endl;
+		results.push_back(RunPhase(reflector, "replay", streams, flat_out, record));
+	}
+
+	g_Cont.Stop();
+
+	std::cout << std::endl << std::left << std::setw(16) << "path" << std::right << std::setw(8) << "sent" << std::setw(9) << "returned" << std::setw(10) << "frames/s"
+		<< std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms" << std::setw(9) << "p99.9 ms" << std::setw(9) << "max ms" << std::setw(12) << "cpu us/frm" << std::endl;
+	bool lost = false;
+	for (const auto &r : results)
+	{
+		Report(r);
+		lost = lost || (r.returned != r.sent);
+	}
+	return lost ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -5,8 +5,24 @@
 
 #include "defines.h"
 
+/*
+  CQbase::quantise() searches the scalar (k = 1) codebooks four entries at a
+  time and stops when the error starts to rise, so they have to be in
+  ascending order and a multiple of four long.
+*/
+template <std::size_t N>
+static constexpr bool scalar_codebook(const float (&cb)[N])
+{
+	if (N % 4)
+		return false;
+	for (std::size_t i=1; i<N; i++)
+		if (cb[i] < cb[i-1])
+			return false;
+	return true;
+}
+
 /* codebook/lsp1.txt */
-static float codes00[] =
+alignas(16) static constexpr float codes00[] =
 {
 	225,
 	250,
@@ -26,7 +42,7 @@ static float codes00[] =
 	600
 };
 /* codebook/lsp2.txt */
-static float codes01[] =
+alignas(16) static constexpr float codes01[] =
 {
 	325,
 	350,
@@ -46,7 +62,7 @@ static float codes01[] =
 	700
 };
 /* codebook/lsp3.txt */
-static float codes02[] =
+alignas(16) static constexpr float codes02[] =
 {
 	500,
 	550,
@@ -66,7 +82,7 @@ static float codes02[] =
 	1250
 };
 /* codebook/lsp4.txt */
-static float codes03[] =
+alignas(16) static constexpr float codes03[] =
 {
 	700,
 	800,
@@ -86,7 +102,7 @@ static float codes03[] =
 	2200
 };
 /* codebook/lsp5.txt */
-static float codes04[] =
+alignas(16) static constexpr float codes04[] =
 {
 	950,
 	1050,
@@ -106,7 +122,7 @@ static float codes04[] =
 	2450
 };
 /* codebook/lsp6.txt */
-static float codes05[] =
+alignas(16) static constexpr float codes05[] =
 {
 	1100,
 	1200,
@@ -126,7 +142,7 @@ static float codes05[] =
 	2600
 };
 /* codebook/lsp7.txt */
-static float codes06[] =
+alignas(16) static constexpr float codes06[] =
 {
 	1500,
 	1600,
@@ -146,7 +162,7 @@ static float codes06[] =
 	3000
 };
 /* codebook/lsp8.txt */
-static float codes07[] =
+alignas(16) static constexpr float codes07[] =
 {
 	2300,
 	2400,
@@ -158,7 +174,7 @@ static float codes07[] =
 	3000
 };
 /* codebook/lsp9.txt */
-static float codes08[] =
+alignas(16) static constexpr float codes08[] =
 {
 	2500,
 	2600,
@@ -170,7 +186,7 @@ static float codes08[] =
 	3200
 };
 /* codebook/lsp10.txt */
-static float codes09[] =
+alignas(16) static constexpr float codes09[] =
 {
 	2900,
 	3100,
@@ -178,6 +194,9 @@ static float codes09[] =
 	3500
 };
 
+static_assert(scalar_codebook(codes00) && scalar_codebook(codes01) && scalar_codebook(codes02) && scalar_codebook(codes03) && scalar_codebook(codes04), "see scalar_codebook()");
+static_assert(scalar_codebook(codes05) && scalar_codebook(codes06) && scalar_codebook(codes07) && scalar_codebook(codes08) && scalar_codebook(codes09), "see scalar_codebook()");
+
 const struct lsp_codebook lsp_cb[] =
 {
 	/* codebook/lsp1.txt */
@@ -254,7 +273,7 @@ const struct lsp_codebook lsp_cb[] =
 };
 
 /* codebook/dlsp1.txt */
-static float codes10[] =
+alignas(16) static constexpr float codes10[] =
 {
 	25,
 	50,
@@ -290,7 +309,7 @@ static float codes10[] =
 	800
 };
 /* codebook/dlsp2.txt */
-static float codes11[] =
+alignas(16) static constexpr float codes11[] =
 {
 	25,
 	50,
@@ -326,7 +345,7 @@ static float codes11[] =
 	800
 };
 /* codebook/dlsp3.txt */
-static float codes12[] =
+alignas(16) static constexpr float codes12[] =
 {
 	25,
 	50,
@@ -362,7 +381,7 @@ static float codes12[] =
 	800
 };
 /* codebook/dlsp4.txt */
-static float codes13[] =
+alignas(16) static constexpr float codes13[] =
 {
 	25,
 	50,
@@ -398,7 +417,7 @@ static float codes13[] =
 	1400
 };
 /* codebook/dlsp5.txt */
-static float codes14[] =
+alignas(16) static constexpr float codes14[] =
 {
 	25,
 	50,
@@ -434,7 +453,7 @@ static float codes14[] =
 	1400
 };
 /* codebook/dlsp6.txt */
-static float codes15[] =
+alignas(16) static constexpr float codes15[] =
 {
 	25,
 	50,
@@ -470,7 +489,7 @@ static float codes15[] =
 	1400
 };
 /* codebook/dlsp7.txt */
-static float codes16[] =
+alignas(16) static constexpr float codes16[] =
 {
 	25,
 	50,
@@ -506,7 +525,7 @@ static float codes16[] =
 	800
 };
 /* codebook/dlsp8.txt */
-static float codes17[] =
+alignas(16) static constexpr float codes17[] =
 {
 	25,
 	50,
@@ -542,7 +561,7 @@ static float codes17[] =
 	800
 };
 /* codebook/dlsp9.txt */
-static float codes18[] =
+alignas(16) static constexpr float codes18[] =
 {
 	25,
 	50,
@@ -578,7 +597,7 @@ static float codes18[] =
 	800
 };
 /* codebook/dlsp10.txt */
-static float codes19[] =
+alignas(16) static constexpr float codes19[] =
 {
 	25,
 	50,
@@ -614,6 +633,9 @@ static float codes19[] =
 	800
 };
 
+static_assert(scalar_codebook(codes10) && scalar_codebook(codes11) && scalar_codebook(codes12) && scalar_codebook(codes13) && scalar_codebook(codes14), "see scalar_codebook()");
+static_assert(scalar_codebook(codes15) && scalar_codebook(codes16) && scalar_codebook(codes17) && scalar_codebook(codes18) && scalar_codebook(codes19), "see scalar_codebook()");
+
 const struct lsp_codebook lsp_cbd[] =
 {
 	/* codebook/dlsp1.txt */
@@ -691,7 +713,7 @@ const struct lsp_codebook lsp_cbd[] =
 
 
 /* codebook/gecb.txt */
-static float codes30[] =
+alignas(16) static constexpr float codes30[] =
 {
 	2.71,  12.0184,
 	0.04675,  -2.73881,
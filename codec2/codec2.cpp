@@ -39,6 +39,26 @@
 #include "codec2.h"
 #include "codec2_internal.h"
 
+/* GCC generic vectors, they are SSE on x86 and NEON on ARM */
+typedef float v4sf __attribute__((vector_size(16)));
+typedef double v4df __attribute__((vector_size(32)));
+typedef int v4si __attribute__((vector_size(16)));
+
+/*
+  cos(2 pi i / FFT_DEC), worked out by the compiler, for the oscillator bank
+  in synthesise().  sin() is the same table, a quarter turn back.
+*/
+static constexpr struct cos_table_tag
+{
+	float c[FFT_DEC];
+	constexpr cos_table_tag() : c()
+	{
+		for (int i=0; i<FFT_DEC; i++)
+			c[i] = cos(2.0 * M_PI * i / FFT_DEC);
+	}
+} cos_dec;
+static_assert(0 == (FFT_DEC & (FFT_DEC - 1)), "the oscillator bank wraps around cos_dec with a mask");
+
 #define HPF_BETA 0.125
 #define BPF_N 101
 
@@ -92,6 +112,7 @@ CCodec2::CCodec2(bool is_3200)
 	for(int i=0; i<m_pitch; i++)
 		c2.Sn[i] = 1.0;
 	c2.hpf_states[0] = c2.hpf_states[1] = 0.0;
+	c2.rand_next = 1;
 	for(int i=0; i<2*n_samp; i++)
 		c2.Sn_[i] = 0;
 	kiss.fft_alloc(c2.fft_fwd_cfg, FFT_ENC, false);
@@ -1146,20 +1167,24 @@ void CCodec2::dft_speech(C2CONST *c2const, FFT_STATE &fft_fwd_cfg, std::complex<
 void CCodec2::two_stage_pitch_refinement(C2CONST *c2const, MODEL *model, std::complex<float> Sw[])
 {
 	float pmin,pmax,pstep;	/* pitch refinment minimum, maximum and step */
+	float Pw[FFT_ENC];	/* |Sw|^2, shared by both refinements */
+
+	for(int b=0; b<FFT_ENC; b++)
+		Pw[b] = Sw[b].real() * Sw[b].real() + Sw[b].imag() * Sw[b].imag();
 
 	/* Coarse refinement */
 
 	pmax = TWO_PI/model->Wo + 5;
 	pmin = TWO_PI/model->Wo - 5;
 	pstep = 1.0;
-	hs_pitch_refinement(model, Sw, pmin, pmax, pstep);
+	hs_pitch_refinement(model, Pw, pmin, pmax, pstep);
 
 	/* Fine refinement */
 
 	pmax = TWO_PI/model->Wo + 1;
 	pmin = TWO_PI/model->Wo - 1;
 	pstep = 0.25;
-	hs_pitch_refinement(model,Sw,pmin,pmax,pstep);
+	hs_pitch_refinement(model, Pw, pmin, pmax, pstep);
 
 	/* Limit range */
 
@@ -1195,16 +1220,13 @@ void CCodec2::two_stage_pitch_refinement(C2CONST *c2const, MODEL *model, std::co
 
 \*---------------------------------------------------------------------------*/
 
-void CCodec2::hs_pitch_refinement(MODEL *model, std::complex<float> Sw[], float pmin, float pmax, float pstep)
+void CCodec2::hs_pitch_refinement(MODEL *model, const float Pw[], float pmin, float pmax, float pstep)
 {
 	int m;		/* loop variable */
-	int b;		/* bin for current harmonic centre */
-	float E;		/* energy for current pitch*/
-	float Wo;		/* current "test" fundamental freq. */
+	float p;		/* current pitch */
 	float Wom;		/* Wo that maximises E */
 	float Em;		/* mamimum energy */
 	float r, one_on_r;	/* number of rads/bin */
-	float p;		/* current pitch */
 
 	/* Initialisation */
 
@@ -1214,25 +1236,37 @@ void CCodec2::hs_pitch_refinement(MODEL *model, std::complex<float> Sw[], float
 	r = TWO_PI/FFT_ENC;
 	one_on_r = 1.0/r;
 
-	/* Determine harmonic sum for a range of Wo values */
+	/*
+	  Determine harmonic sum for a range of Wo values, four at a time.  Each
+	  lane sums its harmonics in the same order, and rounds to the bin in
+	  double, as one at a time would, so the sums and the choice are exact.
+	  Unused lanes have Wo = 0, they only ever look at bin 0.
+	*/
 
-	for(p=pmin; p<=pmax; p+=pstep)
+	p = pmin;
+	while (p <= pmax)
 	{
-		E = 0.0;
-		Wo = TWO_PI/p;
+		v4sf Wo = { 0.0f, 0.0f, 0.0f, 0.0f };
+		int n;
+		for(n=0; n<4 && p<=pmax; n++, p+=pstep)
+			Wo[n] = TWO_PI/p;
 
-		/* Sum harmonic magnitudes */
+		v4sf E = { 0.0f, 0.0f, 0.0f, 0.0f };
 		for(m=1; m<=model->L; m++)
 		{
-			b = (int)(m*Wo*one_on_r + 0.5);
-			E += Sw[b].real() * Sw[b].real() + Sw[b].imag() * Sw[b].imag();
+			const v4si b = __builtin_convertvector(__builtin_convertvector(float(m) * Wo * one_on_r, v4df) + 0.5, v4si);
+			E += v4sf { Pw[b[0]], Pw[b[1]], Pw[b[2]], Pw[b[3]] };
 		}
+
 		/* Compare to see if this is a maximum */
 
-		if (E > Em)
+		for(int i=0; i<n; i++)
 		{
-			Em = E;
-			Wom = Wo;
+			if (E[i] > Em)
+			{
+				Em = E[i];
+				Wom = Wo[i];
+			}
 		}
 	}
 
@@ -1440,6 +1474,111 @@ void CCodec2::make_synthesis_window(C2CONST *c2const, float Pn[])
 		Pn[i] = 0.0;
 }
 
+/*---------------------------------------------------------------------------*\
+
+  FUNCTION....: oscillator_bank
+
+  Does what synthesise()'s inverse FFT does, but only for the 2*n_samp
+  samples the overlap add uses, sw_[FFT_DEC-n_samp+1] to sw_[n_samp], and
+  straight from the nh harmonics X[] at FFT bins bin[].  That's cheaper
+  than the FFT when there are only a few harmonics.  Each harmonic starts
+  from the table and is rotated in steps exactly on the FFT's frequency
+  grid, so the only difference from the FFT is the rounding.
+
+\*---------------------------------------------------------------------------*/
+
+/* one harmonic's four rotations, see oscillator_bank() */
+struct oscillator_tag
+{
+	v4sf zr[4], zi[4];	/* X turned to each of the next sixteen samples */
+	float rc, rs;		/* a turn of sixteen samples */
+};
+
+static inline void oscillator_start(oscillator_tag &o, int b, std::complex<float> X, int n0)
+{
+	const int mask = FFT_DEC - 1;
+	const float scale = b ? 2.0f : 1.0f;	/* the bins above FFT_DEC/2 mirror the ones below */
+	const float xr = scale * X.real();
+	const float xi = scale * X.imag();
+
+	/* the first four samples from the table, then the other twelve are turned by four, eight and twelve */
+	for(int i=0; i<4; i++)
+	{
+		const int j = (b * (n0 + i)) & mask;
+		const float c = cos_dec.c[j];
+		const float s = cos_dec.c[(j - FFT_DEC/4) & mask];
+		o.zr[0][i] = xr*c - xi*s;
+		o.zi[0][i] = xr*s + xi*c;
+	}
+	for(int i=1; i<4; i++)
+	{
+		const int j = (4*i*b) & mask;
+		const float c = cos_dec.c[j];
+		const float s = cos_dec.c[(j - FFT_DEC/4) & mask];
+		o.zr[i] = o.zr[0]*c - o.zi[0]*s;
+		o.zi[i] = o.zr[0]*s + o.zi[0]*c;
+	}
+	o.rc = cos_dec.c[(16*b) & mask];
+	o.rs = cos_dec.c[(16*b - FFT_DEC/4) & mask];
+}
+
+/* returns the real parts of the sixteen samples, and turns on to the next sixteen */
+static inline void oscillator_step(oscillator_tag &o, v4sf out[4])
+{
+	for(int i=0; i<4; i++)
+	{
+		out[i] = o.zr[i];
+		const v4sf t = o.zr[i]*o.rc - o.zi[i]*o.rs;
+		o.zi[i] = o.zr[i]*o.rs + o.zi[i]*o.rc;
+		o.zr[i] = t;
+	}
+}
+
+void oscillator_bank(int n_samp, float sw_[], const int bin[], const std::complex<float> X[], int nh)
+{
+	const int n0 = 1 - n_samp;	/* sw_[FFT_DEC-n_samp+1] is sample -(n_samp-1) */
+	v4sf y[FFT_DEC/4];
+	int  h, i, k;
+
+	/* sixteen samples a step, as four separate rotations so they don't wait on each other, two harmonics at a time */
+	assert(2*n_samp <= FFT_DEC && 0 == (2*n_samp) % 16);
+	for(k=0; k<n_samp/2; k++)
+		y[k] = v4sf { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	for(h=0; h+1<nh; h+=2)
+	{
+		oscillator_tag a, b;
+		oscillator_start(a, bin[h], X[h], n0);
+		oscillator_start(b, bin[h+1], X[h+1], n0);
+		for(k=0; k<n_samp/2; k+=4)
+		{
+			v4sf ya[4], yb[4];
+			oscillator_step(a, ya);
+			oscillator_step(b, yb);
+			for(i=0; i<4; i++)
+				y[k+i] += ya[i] + yb[i];
+		}
+	}
+	if (h < nh)
+	{
+		oscillator_tag a;
+		oscillator_start(a, bin[h], X[h], n0);
+		for(k=0; k<n_samp/2; k+=4)
+		{
+			v4sf ya[4];
+			oscillator_step(a, ya);
+			for(i=0; i<4; i++)
+				y[k+i] += ya[i];
+		}
+	}
+
+	const float *out = (const float *)y;
+	for(i=0; i<n_samp-1; i++)
+		sw_[FFT_DEC-n_samp+1+i] = out[i];
+	for(i=0; i<=n_samp; i++)
+		sw_[i] = out[n_samp-1+i];
+}
+
 /*---------------------------------------------------------------------------*\
 
   FUNCTION....: synthesise
@@ -1464,6 +1603,8 @@ void CCodec2::synthesise(
 	int   i,l,j,b;	        /* loop variables */
 	std::complex<float>  Sw_[FFT_DEC/2+1];	/* DFT of synthesised signal */
 	float sw_[FFT_DEC];	        /* synthesised signal */
+	int   bin[MAX_AMP+1];	        /* the FFT bin of each harmonic */
+	std::complex<float>  X[MAX_AMP+1];	/* and its amplitude and phase */
 
 	if (shift)
 	{
@@ -1475,14 +1616,9 @@ void CCodec2::synthesise(
 		Sn_[n_samp-1] = 0.0;
 	}
 
-	for(i=0; i<FFT_DEC/2+1; i++)
-	{
-		Sw_[i].real(0);
-		Sw_[i].imag(0);
-	}
-
-	/* Now set up frequency domain synthesised speech */
+	/* Now set up frequency domain synthesised speech, when harmonics share a bin the last one wins */
 
+	int nh = 0;
 	for(l=1; l<=model->L; l++)
 	{
 		b = (int)(l*model->Wo*FFT_DEC/TWO_PI + 0.5);
@@ -1490,12 +1626,29 @@ void CCodec2::synthesise(
 		{
 			b = (FFT_DEC/2)-1;
 		}
-		Sw_[b] = std::polar(model->A[l], model->phi[l]);
+		if (nh == 0 || bin[nh-1] != b)
+			bin[nh++] = b;
+		X[nh-1] = std::polar(model->A[l], model->phi[l]);
 	}
 
-	/* Perform inverse DFT */
+	/* Perform inverse DFT, or an oscillator bank, whichever is cheaper */
 
-	kiss.fftri(*fftr_inv_cfg, Sw_,sw_);
+	if (nh <= SYNTH_BANK_MAX_L)
+	{
+		oscillator_bank(n_samp, sw_, bin, X, nh);
+	}
+	else
+	{
+		for(i=0; i<FFT_DEC/2+1; i++)
+		{
+			Sw_[i].real(0);
+			Sw_[i].imag(0);
+		}
+		for(l=0; l<nh; l++)
+			Sw_[bin[l]] = X[l];
+
+		kiss.fftri(*fftr_inv_cfg, Sw_,sw_);
+	}
 
 	/* Overlap add to previous samples */
 
@@ -1512,11 +1665,11 @@ void CCodec2::synthesise(
 			Sn_[i] += sw_[j]*Pn[i];
 }
 
+// the state is kept in each instance, so instances on different threads don't share it
 int CCodec2::codec2_rand(void)
 {
-	static unsigned long next = 1;
-	next = next * 1103515245 + 12345;
-	return((unsigned)(next/65536) % 32768);
+	c2.rand_next = c2.rand_next * 1103515245 + 12345;
+	return((unsigned)(c2.rand_next/65536) % 32768);
 }
 
 /*---------------------------------------------------------------------------*\
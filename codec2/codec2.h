@@ -46,6 +46,12 @@
 
 #define CODEC2_RAND_MAX 32767
 
+/* synthesise() uses the oscillator bank for up to this many harmonics, the inverse FFT for more */
+#define SYNTH_BANK_MAX_L 12
+
+/* the 2*n_samp samples synthesise() overlap adds, from nh harmonics X[] at FFT_DEC bins bin[] */
+void oscillator_bank(int n_samp, float sw_[], const int bin[], const std::complex<float> X[], int nh);
+
 class CCodec2
 {
 public:
@@ -57,6 +63,8 @@ public:
 	int  codec2_bits_per_frame();
 
 private:
+	friend class CCodec2Bench;	// bench/Codec2Bench.cpp times the stages
+
 	// merged from other files
 	void sample_phase(MODEL *model, std::complex<float> filter_phase[], std::complex<float> A[]);
 	void phase_synth_zero_order(int n_samp, MODEL *model, float *ex_phase, std::complex<float> filter_phase[]);
@@ -72,7 +80,7 @@ private:
 	void make_synthesis_window(C2CONST *c2const, float Pn[]);
 	void synthesise(int n_samp, FFTR_STATE *fftr_inv_cfg, float Sn_[], MODEL *model, float Pn[], int shift);
 	int codec2_rand(void);
-	void hs_pitch_refinement(MODEL *model, std::complex<float> Sw[], float pmin, float pmax, float pstep);
+	void hs_pitch_refinement(MODEL *model, const float Pw[], float pmin, float pmax, float pstep);
 
 	void interp_Wo(MODEL *interp, MODEL *prev, MODEL *next, float Wo_min);
 	void interp_Wo2(MODEL *interp, MODEL *prev, MODEL *next, float weight, float Wo_min);
@@ -50,6 +50,7 @@ using CODEC2 = struct codec2_tag {
 	float              xq_dec[2];
 	float              W[FFT_ENC];	             /* DFT of w[]                                */
 	float              hpf_states[2];            /* high pass filter states                   */
+	unsigned long      rand_next;                /* codec2_rand() state, one per instance     */
 	float              prev_lsps_dec[LPC_ORD];   /* previous frame's LSPs                     */
 	float             *softdec;                  /* optional soft decn bits from demod        */
 	MODEL              prev_model_dec;           /* previous frame's model parameters         */
@@ -102,7 +102,7 @@ struct lsp_codebook
 	int     k; /* dimension of vector  */
 	int log2m; /* number of bits in m  */
 	int     m; /* elements in codebook */
-	float *cb; /* The elements         */
+	const float *cb; /* The elements   */
 };
 
 using FFT_STATE = struct fft_state_tag
@@ -0,0 +1,330 @@
+/*
+  Copyright © 2026 Thomas A. Early N7TAE
+
+  FFTs for sizes that are known at compile time.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU Lesser General Public License version 2.1, as
+  published by the Free Software Foundation.  This program is
+  distributed in the hope that it will be useful, but WITHOUT ANY
+  WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public
+  License for more details.
+
+  You should have received a copy of the GNU Lesser General Public License
+  along with this program; if not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef FIXED_FFT_H
+#define FIXED_FFT_H
+
+#include <complex>
+#include <cmath>
+#include <cstring>
+
+/*
+  These do the same mixed radix, decimation in time FFT as CKissFFT, radix 4
+  stages and then a radix 2 stage if it's needed, so the results agree with
+  CKissFFT to within rounding.  But the size is a template parameter, so the
+  input permutation, the stages and each stage's twiddles are all worked out
+  by the compiler, the stages are unrolled, and there is no recursion and no
+  heap.  The butterflies use GCC's generic vectors, two complex values at a
+  time, which are SSE on x86 and NEON on ARM.
+
+  CKissFFT uses these for the sizes the codec uses, and does every other
+  size itself.
+*/
+
+namespace fixed_fft
+{
+	using v4sf = float __attribute__((vector_size(16)));
+	using v4si = int __attribute__((vector_size(16)));
+
+	// through float *, std::complex isn't trivial enough for -Wclass-memaccess
+	inline v4sf Load(const std::complex<float> *p)
+	{
+		v4sf v;
+		memcpy(&v, reinterpret_cast<const float *>(p), sizeof(v));
+		return v;
+	}
+
+	inline void Store(std::complex<float> *p, v4sf v)
+	{
+		memcpy(reinterpret_cast<float *>(p), &v, sizeof(v));
+	}
+
+	// two complex multiplies, worked out like std::complex does, so without a NaN
+	// the results are the same: (ac - bd, bc + ad)
+	inline v4sf Mul(v4sf x, v4sf y)
+	{
+		const v4sf yr = __builtin_shuffle(y, v4si { 0, 0, 2, 2 });
+		const v4sf yi = __builtin_shuffle(y, v4si { 1, 1, 3, 3 });
+		const v4sf xs = __builtin_shuffle(x, v4si { 1, 0, 3, 2 });
+		return x * yr + xs * yi * v4sf { -1.0f, 1.0f, -1.0f, 1.0f };
+	}
+
+	// CKissFFT's twiddle, but worked out by the compiler
+	constexpr std::complex<float> Twiddle(double phase)
+	{
+		return std::complex<float>(std::cos(float(phase)), std::sin(float(phase)));
+	}
+
+	constexpr double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+
+	// everything about a transform that doesn't depend on the data
+	template <int NFFT, bool INVERSE>
+	struct STables
+	{
+		static_assert(NFFT >= 4 && 0 == (NFFT & (NFFT - 1)), "the fixed FFTs are only for powers of two");
+
+		static constexpr int max_stages = 16;
+		int stages = 0;
+		int radix[max_stages] {}, m[max_stages] {}, tw_offset[max_stages] {};
+		int perm[NFFT] {};	// the output gets input[perm[i]] before the first butterfly
+		std::complex<float> tw[3 * NFFT] {};	// each stage's twiddles, in the order its butterflies use them
+
+		constexpr STables()
+		{
+			// like kf_factor(), all the 4s that fit, then a 2 if it's needed
+			for (int n=NFFT; n>1; stages++)
+			{
+				radix[stages] = (n % 4) ? 2 : 4;
+				n /= radix[stages];
+				m[stages] = n;
+			}
+
+			Permute(0, 0, 0, 1);
+
+			std::complex<float> base[NFFT] {};
+			for (int i=0; i<NFFT; i++)
+				base[i] = Twiddle((INVERSE ? 2.0 : -2.0) * pi * i / NFFT);
+
+			int offset = 0;
+			for (int s=0; s<stages; s++)
+			{
+				const int fstride = NFFT / (radix[s] * m[s]);
+				tw_offset[s] = offset;
+				for (int j=1; j<radix[s]; j++)
+				{
+					for (int k=0; k<m[s]; k++)
+						tw[offset++] = base[j * k * fstride];
+				}
+			}
+		}
+
+		// what kf_work() does, but only to find where each input goes
+		constexpr void Permute(int stage, int out, int in, int fstride)
+		{
+			for (int q=0; q<radix[stage]; q++)
+			{
+				if (1 == m[stage])
+					perm[out + q] = in + q * fstride;
+				else
+					Permute(stage + 1, out + q * m[stage], in + q * fstride, fstride * radix[stage]);
+			}
+		}
+	};
+
+	template <int NFFT, bool INVERSE>
+	struct SRealTables
+	{
+		static constexpr int ncfft = NFFT / 2;
+		std::complex<float> super_twiddles[ncfft / 2] {};
+
+		constexpr SRealTables()
+		{
+			for (int i=0; i<ncfft/2; i++)
+			{
+				const double phase = -pi * (double(i + 1) / ncfft + 0.5);
+				super_twiddles[i] = Twiddle(INVERSE ? -phase : phase);
+			}
+		}
+	};
+}
+
+template <int NFFT, bool INVERSE>
+class CFixedFFT
+{
+public:
+	// fin and fout can be the same
+	static void Transform(const std::complex<float> *fin, std::complex<float> *fout)
+	{
+		std::complex<float> copy[NFFT];
+		if (fin == fout)
+		{
+			memcpy(copy, fin, sizeof(copy));
+			fin = copy;
+		}
+		for (int i=0; i<NFFT; i++)
+			fout[i] = fin[tables.perm[i]];
+		Stage<tables.stages - 1>(fout);
+	}
+
+private:
+	static constexpr fixed_fft::STables<NFFT, INVERSE> tables {};
+
+	// the stages run from the last factor to the first, like kf_work() unwinding
+	template <int STAGE>
+	static void Stage(std::complex<float> *f)
+	{
+		constexpr int radix = tables.radix[STAGE], m = tables.m[STAGE];
+		const std::complex<float> *tw = tables.tw + tables.tw_offset[STAGE];
+		for (int b=0; b<NFFT; b+=radix*m)
+		{
+			if (1 == m)
+			{
+				if (4 == radix)
+					Leaf4(f + b);
+				else
+					Leaf2(f + b);
+			}
+			else
+			{
+				if (4 == radix)
+					Radix4(f + b, m, tw);
+				else
+					Radix2(f + b, m, tw);
+			}
+		}
+		if constexpr (STAGE > 0)
+			Stage<STAGE - 1>(f);
+	}
+
+	// the first stage has m = 1, so every twiddle is 1, and only the butterfly is left
+	static void Leaf2(std::complex<float> *f)
+	{
+		using namespace fixed_fft;
+		const v4sf x = Load(f);
+		const v4sf a = __builtin_shuffle(x, v4si { 0, 1, 0, 1 });
+		const v4sf b = __builtin_shuffle(x, v4si { 2, 3, 2, 3 });
+		Store(f, a + b * v4sf { 1.0f, 1.0f, -1.0f, -1.0f });
+	}
+
+	static void Leaf4(std::complex<float> *f)
+	{
+		using namespace fixed_fft;
+		const v4sf lo = Load(f), hi = Load(f + 2);
+		const v4sf sum = lo + hi;	// f0 + f2, f1 + f3
+		const v4sf dif = lo - hi;	// f0 - f2, f1 - f3
+		const v4sf a = __builtin_shuffle(sum, v4si { 0, 1, 0, 1 });
+		const v4sf b = __builtin_shuffle(sum, v4si { 2, 3, 2, 3 });
+		const v4sf c = __builtin_shuffle(dif, v4si { 0, 1, 0, 1 });
+		const v4sf d = __builtin_shuffle(dif, v4si { 3, 2, 3, 2 });	// swapped, for multiplying by -i or i
+		constexpr v4sf sign = INVERSE ? v4sf { -1.0f, 1.0f, 1.0f, -1.0f } : v4sf { 1.0f, -1.0f, -1.0f, 1.0f };
+		const v4sf even = a + b * v4sf { 1.0f, 1.0f, -1.0f, -1.0f };	// outputs 0 and 2
+		const v4sf odd = c + d * sign;	// outputs 1 and 3
+		Store(f, __builtin_shuffle(even, odd, v4si { 0, 1, 4, 5 }));
+		Store(f + 2, __builtin_shuffle(even, odd, v4si { 2, 3, 6, 7 }));
+	}
+
+	// kf_bfly2(), two at a time
+	static void Radix2(std::complex<float> *f, int m, const std::complex<float> *tw)
+	{
+		using namespace fixed_fft;
+		for (int k=0; k<m; k+=2)
+		{
+			const v4sf t = Mul(Load(f + m + k), Load(tw + k));
+			const v4sf f0 = Load(f + k);
+			Store(f + m + k, f0 - t);
+			Store(f + k, f0 + t);
+		}
+	}
+
+	// kf_bfly4(), two at a time, with the same operations in the same order
+	static void Radix4(std::complex<float> *f, int m, const std::complex<float> *tw)
+	{
+		using namespace fixed_fft;
+		constexpr v4sf sign = INVERSE ? v4sf { -1.0f, 1.0f, -1.0f, 1.0f } : v4sf { 1.0f, -1.0f, 1.0f, -1.0f };
+		for (int k=0; k<m; k+=2)
+		{
+			const v4sf s0 = Mul(Load(f + m + k), Load(tw + k));
+			const v4sf s1 = Mul(Load(f + 2 * m + k), Load(tw + m + k));
+			const v4sf s2 = Mul(Load(f + 3 * m + k), Load(tw + 2 * m + k));
+			v4sf f0 = Load(f + k);
+			const v4sf s5 = f0 - s1;
+			f0 += s1;
+			const v4sf s3 = s0 + s2;
+			const v4sf s4 = __builtin_shuffle(s0 - s2, v4si { 1, 0, 3, 2 }) * sign;
+			Store(f + 2 * m + k, f0 - s3);
+			Store(f + k, f0 + s3);
+			Store(f + m + k, s5 + s4);
+			Store(f + 3 * m + k, s5 - s4);
+		}
+	}
+};
+
+// the real FFTs, CKissFFT::fftr() and fftri(), with a complex FFT of half the size
+// the spectrum is NFFT/2+1 complex values
+template <int NFFT, bool INVERSE>
+class CFixedFFTR
+{
+	static constexpr int ncfft = NFFT / 2;
+
+public:
+	static void Forward(const float *timedata, std::complex<float> *freqdata)
+	{
+		static_assert(! INVERSE, "this is an inverse transform");
+		using namespace fixed_fft;
+		std::complex<float> tmp[ncfft];
+		CFixedFFT<ncfft, false>::Transform(reinterpret_cast<const std::complex<float> *>(timedata), tmp);
+
+		const auto tdc = tmp[0];
+		freqdata[0] = std::complex<float>(tdc.real() + tdc.imag(), 0.0f);
+		freqdata[ncfft] = std::complex<float>(tdc.real() - tdc.imag(), 0.0f);
+
+		// k and k+1 with ncfft-k and ncfft-k-1, the last two, where they meet, one at a time
+		int k = 1;
+		for (; k+1<ncfft/2; k+=2)
+		{
+			const v4sf fpk = Load(tmp + k);
+			const v4sf fpnk = __builtin_shuffle(Load(tmp + ncfft - k - 1), v4si { 2, 3, 0, 1 }) * v4sf { 1.0f, -1.0f, 1.0f, -1.0f };
+			const v4sf f1k = fpk + fpnk;
+			const v4sf tw = Mul(fpk - fpnk, Load(tables.super_twiddles + k - 1));
+			Store(freqdata + k, (f1k + tw) * 0.5f);
+			Store(freqdata + ncfft - k - 1, __builtin_shuffle((f1k - tw) * v4sf { 0.5f, -0.5f, 0.5f, -0.5f }, v4si { 2, 3, 0, 1 }));
+		}
+		for (; k<=ncfft/2; k++)
+		{
+			const auto fpk = tmp[k];
+			const auto fpnk = std::conj(tmp[ncfft - k]);
+			const auto f1k = fpk + fpnk;
+			const auto tw = (fpk - fpnk) * tables.super_twiddles[k - 1];
+			freqdata[k] = 0.5f * (f1k + tw);
+			freqdata[ncfft - k] = std::complex<float>(0.5f * (f1k.real() - tw.real()), 0.5f * (tw.imag() - f1k.imag()));
+		}
+	}
+
+	static void Inverse(const std::complex<float> *freqdata, float *timedata)
+	{
+		static_assert(INVERSE, "this is a forward transform");
+		using namespace fixed_fft;
+		std::complex<float> tmp[ncfft];
+		tmp[0] = std::complex<float>(freqdata[0].real() + freqdata[ncfft].real(), freqdata[0].real() - freqdata[ncfft].real());
+
+		int k = 1;
+		for (; k+1<ncfft/2; k+=2)
+		{
+			const v4sf fk = Load(freqdata + k);
+			const v4sf fnkc = __builtin_shuffle(Load(freqdata + ncfft - k - 1), v4si { 2, 3, 0, 1 }) * v4sf { 1.0f, -1.0f, 1.0f, -1.0f };
+			const v4sf fek = fk + fnkc;
+			const v4sf fok = Mul(fk - fnkc, Load(tables.super_twiddles + k - 1));
+			Store(tmp + k, fek + fok);
+			Store(tmp + ncfft - k - 1, __builtin_shuffle((fek - fok) * v4sf { 1.0f, -1.0f, 1.0f, -1.0f }, v4si { 2, 3, 0, 1 }));
+		}
+		for (; k<=ncfft/2; k++)
+		{
+			const auto fk = freqdata[k];
+			const auto fnkc = std::conj(freqdata[ncfft - k]);
+			const auto fek = fk + fnkc;
+			const auto fok = (fk - fnkc) * tables.super_twiddles[k - 1];
+			tmp[k] = fek + fok;
+			tmp[ncfft - k] = std::conj(fek - fok);
+		}
+		CFixedFFT<ncfft, true>::Transform(tmp, reinterpret_cast<std::complex<float> *>(timedata));
+	}
+
+private:
+	static constexpr fixed_fft::SRealTables<NFFT, INVERSE> tables {};
+};
+
+#endif
@@ -17,6 +17,7 @@ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
 
 #include "defines.h"
 #include "kiss_fft.h"
+#include "fixed_fft.h"
 
 void CKissFFT::kf_bfly2(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m)
 {
@@ -337,7 +338,12 @@ void CKissFFT::fft_stride(FFT_STATE &st, const std::complex<float> *fin, std::co
 
 void CKissFFT::fft(FFT_STATE &cfg, const std::complex<float> *fin, std::complex<float> *fout)
 {
-	fft_stride(cfg, fin, fout, 1);
+	if (use_fixed && FFT_ENC == cfg.nfft && ! cfg.inverse)
+		CFixedFFT<FFT_ENC, false>::Transform(fin, fout);
+	else if (use_fixed && FFT_DEC == cfg.nfft && cfg.inverse)
+		CFixedFFT<FFT_DEC, true>::Transform(fin, fout);
+	else
+		fft_stride(cfg, fin, fout, 1);
 }
 
 int CKissFFT::fft_next_fast_size(int n)
@@ -376,6 +382,12 @@ void CKissFFT::fftr(FFTR_STATE &st, const float *timedata, std::complex<float> *
 {
 	assert(st.substate.inverse == false);
 
+	if (use_fixed && FFT_ENC/2 == st.substate.nfft)
+	{
+		CFixedFFTR<FFT_ENC, false>::Forward(timedata, freqdata);
+		return;
+	}
+
 	auto ncfft = st.substate.nfft;
 
 	/*perform the parallel fft of two real signals packed in real,imag*/
@@ -415,6 +427,12 @@ void CKissFFT::fftri(FFTR_STATE &st, const std::complex<float> *freqdata, float
 {
 	assert(st.substate.inverse == true);
 
+	if (use_fixed && FFT_DEC/2 == st.substate.nfft)
+	{
+		CFixedFFTR<FFT_DEC, true>::Inverse(freqdata, timedata);
+		return;
+	}
+
 	auto ncfft = st.substate.nfft;
 
 	st.tmpbuf[0].real(freqdata[0].real() + freqdata[ncfft].real());
@@ -16,6 +16,8 @@
 class CKissFFT
 {
 public:
+	// with fixed, the sizes the codec uses are done by the FFTs in fixed_fft.h
+	CKissFFT(bool fixed = true) : use_fixed(fixed) {}
 	void fft_alloc(FFT_STATE &state, const int nfft, const bool inverse_fft);
 	void fft(FFT_STATE &cfg, const std::complex<float> *fin, std::complex<float> *fout);
 	void fft_stride(FFT_STATE &cfg, const std::complex<float> *fin, std::complex<float> *fout, int fin_stride);
@@ -24,6 +26,7 @@ public:
 	void fftr(FFTR_STATE &cfg,const float *timedata,std::complex<float> *freqdata);
 	void fftri(FFTR_STATE &cfg,const std::complex<float> *freqdata,float *timedata);
 private:
+	const bool use_fixed;
 	void kf_bfly2(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
 	void kf_bfly3(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
 	void kf_bfly4(std::complex<float> *Fout, const size_t fstride, FFT_STATE &st, int m);
@@ -29,6 +29,14 @@
 #include <math.h>
 #include <stdlib.h>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NLP_X86
+#elif defined(__ARM_NEON) || defined(__aarch64__)
+#include <arm_neon.h>
+#define NLP_NEON
+#endif
+
 #include "defines.h"
 #include "nlp.h"
 #include "kiss_fft.h"
@@ -146,6 +154,59 @@ static const float fdmdv_os_filter[]= {
     -0.0008215855034550383
 };
 
+/*---------------------------------------------------------------------------*\
+
+  fir_decimate()
+
+  The NLP low pass filter, working out only the outputs that are kept
+  after decimation.  x[] has NLP_NTAP-1 samples of history, then the n
+  new samples, and y[k] is the filter output for the new sample
+  first+k*DEC.  Returns the number of outputs.
+
+  The inputs are split into DEC phases, so each tap's inputs for four
+  outputs in a row are next to each other, and four outputs are worked
+  out at once.  Each output still adds its taps in order, without fused
+  multiply-adds, so it's the same as a plain scalar filter.
+
+\*---------------------------------------------------------------------------*/
+
+static int fir_decimate(float y[], const float x[], int n, int first)
+{
+	float ph[DEC][(NLP_NTAP-1+PMAX_M)/DEC + 1];
+	const int count = (n - first + DEC - 1) / DEC;
+	int k, j;
+
+	for(j=first; j<NLP_NTAP-1+n; j++)
+		ph[(j-first)%DEC][(j-first)/DEC] = x[j];
+
+	k = 0;
+#if defined(NLP_X86)
+	for(; k+4<=count; k+=4)
+	{
+		__m128 acc = _mm_setzero_ps();
+		for(j=0; j<NLP_NTAP; j++)
+			acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(&ph[j%DEC][k + j/DEC]), _mm_set1_ps(nlp_fir[j])));
+		_mm_storeu_ps(&y[k], acc);
+	}
+#elif defined(NLP_NEON)
+	for(; k+4<=count; k+=4)
+	{
+		float32x4_t acc = vdupq_n_f32(0.0f);
+		for(j=0; j<NLP_NTAP; j++)
+			acc = vaddq_f32(acc, vmulq_f32(vld1q_f32(&ph[j%DEC][k + j/DEC]), vdupq_n_f32(nlp_fir[j])));
+		vst1q_f32(&y[k], acc);
+	}
+#endif
+	for(; k<count; k++)
+	{
+		float acc = 0.0;
+		for(j=0; j<NLP_NTAP; j++)
+			acc += ph[j%DEC][k + j/DEC]*nlp_fir[j];
+		y[k] = acc;
+	}
+	return count;
+}
+
 /*---------------------------------------------------------------------------*\
 
   nlp_create()
@@ -191,10 +252,11 @@ void Cnlp::nlp_create(C2CONST *c2const)
 		snlp.sq[i] = 0.0;
 	snlp.mem_x = 0.0;
 	snlp.mem_y = 0.0;
-	for(i=0; i<NLP_NTAP; i++)
+	for(i=0; i<NLP_NTAP-1; i++)
 		snlp.mem_fir[i] = 0.0;
 
-	kiss.fft_alloc(snlp.fft_cfg, PE_FFT_SIZE, false);
+	static_assert(PE_FFT_SIZE == FFT_ENC, "the NLP shares the encoder's fixed size real FFT");
+	kiss.fftr_alloc(snlp.fftr_cfg, PE_FFT_SIZE, false);
 }
 
 /*---------------------------------------------------------------------------*\
@@ -207,7 +269,9 @@ void Cnlp::nlp_create(C2CONST *c2const)
 
 void Cnlp::nlp_destroy()
 {
-	snlp.fft_cfg.twiddles.clear();
+	snlp.fftr_cfg.substate.twiddles.clear();
+	snlp.fftr_cfg.tmpbuf.clear();
+	snlp.fftr_cfg.super_twiddles.clear();
 }
 
 /*---------------------------------------------------------------------------*\
@@ -250,10 +314,12 @@ float Cnlp::nlp(
 )
 {
 	float  notch;		    /* current notch filter output          */
-	std::complex<float>   Fw[PE_FFT_SIZE]; /* DFT of squared signal (input/output) */
+	float  sqw[PE_FFT_SIZE];    /* decimated and windowed squared signal */
+	std::complex<float>   Fc[PE_FFT_SIZE/2+1]; /* its DFT, the input is real so this is only half of it */
+	float  Fw[PE_FFT_SIZE/2+1]; /* power spectrum of the squared signal */
 	float  gmax;
 	int    gmax_bin;
-	int    m, i, j;
+	int    m, i;
 	float  best_f0;
 
 	m = snlp.m;
@@ -264,19 +330,13 @@ float Cnlp::nlp(
 	   Fs = 8kHz. The decimating filter introduces about 3ms of delay,
 	   that shouldn't be a problem as pitch changes slowly. */
 
-	if (snlp.Fs == 8000)
-	{
-		/* Square latest input samples */
+	/* the new samples go after the FIR filter's history */
 
-		for(i=m-n; i<m; i++)
-		{
-			snlp.sq[i] = Sn[i]*Sn[i];
-		}
-	}
-	else
-	{
-		assert(snlp.Fs == 16000);
+	float *x = &snlp.mem_fir[NLP_NTAP-1];
+	const float *in = &Sn[m-n];
 
+	if (snlp.Fs == 16000)
+	{
 		/* re-sample at 8 KHz */
 
 		for(i=0; i<n; i++)
@@ -287,25 +347,25 @@ float Cnlp::nlp(
 		m /= 2;
 		n /= 2;
 
-		float Sn8k[n];
-		fdmdv_16_to_8(Sn8k, &snlp.Sn16k[FDMDV_OS_TAPS_16K], n);
+		fdmdv_16_to_8(x, &snlp.Sn16k[FDMDV_OS_TAPS_16K], n);
+		in = x;
+	}
+	else
+		assert(snlp.Fs == 8000);
 
-		/* Square latest input samples */
+	/* only every DEC'th filtered sample is used, and they stay in step as
+	   sq[] is shifted, so long as it shifts by a multiple of DEC */
 
-		for(i=m-n, j=0; i<m; i++, j++)
-		{
-			snlp.sq[i] = Sn8k[j]*Sn8k[j];
-		}
-		assert(j <= n);
-	}
+	assert(0 == n % DEC);
 
-	for(i=m-n; i<m; i++)  	/* notch filter at DC */
+	for(i=0; i<n; i++)	/* square, and notch filter at DC */
 	{
-		notch = snlp.sq[i] - snlp.mem_x;
+		const float sq = in[i]*in[i];
+		notch = sq - snlp.mem_x;
 		notch += COEFF*snlp.mem_y;
-		snlp.mem_x = snlp.sq[i];
+		snlp.mem_x = sq;
 		snlp.mem_y = notch;
-		snlp.sq[i] = notch + 1.0;  /* With 0 input vectors to codec,
+		x[i] = notch + 1.0;  /* With 0 input vectors to codec,
 				      kiss_fft() would take a long
 				      time to execute when running in
 				      real time.  Problem was traced
@@ -315,36 +375,33 @@ float Cnlp::nlp(
 				      exactly sure why. */
 	}
 
-	for(i=m-n; i<m; i++)  	/* FIR filter vector */
-	{
+	/* FIR filter, only the outputs that are decimated */
 
-		for(j=0; j<NLP_NTAP-1; j++)
-			snlp.mem_fir[j] = snlp.mem_fir[j+1];
-		snlp.mem_fir[NLP_NTAP-1] = snlp.sq[i];
+	const int first = (DEC - (m-n) % DEC) % DEC;
+	float y[PMAX_M/DEC];
+	const int count = fir_decimate(y, snlp.mem_fir, n, first);
+	for(i=0; i<count; i++)
+		snlp.sq[m-n+first+i*DEC] = y[i];
 
-		snlp.sq[i] = 0.0;
-		for(j=0; j<NLP_NTAP; j++)
-			snlp.sq[i] += snlp.mem_fir[j]*nlp_fir[j];
-	}
+	/* keep the last NLP_NTAP-1 samples for next time */
+
+	for(i=0; i<NLP_NTAP-1; i++)
+		snlp.mem_fir[i] = snlp.mem_fir[n+i];
 
 	/* Decimate and DFT */
 
-	for(i=0; i<PE_FFT_SIZE; i++)
-	{
-		Fw[i].real(0);
-		Fw[i].imag(0);
-	}
 	for(i=0; i<m/DEC; i++)
-	{
-		Fw[i].real(snlp.sq[i*DEC]*snlp.w[i]);
-	}
+		sqw[i] = snlp.sq[i*DEC]*snlp.w[i];
+	for(; i<PE_FFT_SIZE; i++)
+		sqw[i] = 0.0;
+
+	/* the pitch search only looks below PE_FFT_SIZE/(2*DEC), so the upper half of
+	   the spectrum, the mirror image of the lower half, isn't needed */
 
-	// FIXME: check if this can be converted to a real fft
-	// since all imag inputs are 0
-	codec2_fft_inplace(snlp.fft_cfg, Fw);
+	kiss.fftr(snlp.fftr_cfg, sqw, Fc);
 
-	for(i=0; i<PE_FFT_SIZE; i++)
-		Fw[i].real(Fw[i].real() * Fw[i].real() + Fw[i].imag() * Fw[i].imag());
+	for(i=0; i<=PE_FFT_SIZE/2; i++)
+		Fw[i] = Fc[i].real() * Fc[i].real() + Fc[i].imag() * Fc[i].imag();
 
 	/* todo: express everything in f0, as pitch in samples is dep on Fs */
 
@@ -357,9 +414,9 @@ float Cnlp::nlp(
 	gmax_bin = PE_FFT_SIZE*DEC/pmax;
 	for(i=PE_FFT_SIZE*DEC/pmax; i<=PE_FFT_SIZE*DEC/pmin; i++)
 	{
-		if (Fw[i].real() > gmax)
+		if (Fw[i] > gmax)
 		{
-			gmax = Fw[i].real();
+			gmax = Fw[i];
 			gmax_bin = i;
 		}
 	}
@@ -401,7 +458,7 @@ float Cnlp::nlp(
 
 \*---------------------------------------------------------------------------*/
 
-float Cnlp::post_process_sub_multiples(std::complex<float> Fw[], int pmax, float gmax, int gmax_bin, float *prev_f0)
+float Cnlp::post_process_sub_multiples(float Fw[], int pmax, float gmax, int gmax_bin, float *prev_f0)
 {
 	int   min_bin, cmax_bin;
 	int   mult;
@@ -437,14 +494,14 @@ float Cnlp::post_process_sub_multiples(std::complex<float> Fw[], int pmax, float
 		lmax = 0;
 		lmax_bin = bmin;
 		for (b=bmin; b<=bmax; b++) 	     /* look for maximum in interval */
-			if (Fw[b].real() > lmax)
+			if (Fw[b] > lmax)
 			{
-				lmax = Fw[b].real();
+				lmax = Fw[b];
 				lmax_bin = b;
 			}
 
 		if (lmax > thresh)
-			if ((lmax > Fw[lmax_bin-1].real()) && (lmax > Fw[lmax_bin+1].real()))
+			if ((lmax > Fw[lmax_bin-1]) && (lmax > Fw[lmax_bin+1]))
 			{
 				cmax_bin = lmax_bin;
 			}
@@ -64,8 +64,8 @@ using NLP = struct nlp_tag
 	float         w[PMAX_M/DEC];     /* DFT window                   */
 	float         sq[PMAX_M];	     /* squared speech samples       */
 	float         mem_x,mem_y;       /* memory for notch filter      */
-	float         mem_fir[NLP_NTAP]; /* decimation FIR filter memory */
-	FFT_STATE     fft_cfg;           /* kiss FFT config              */
+	float         mem_fir[NLP_NTAP-1+PMAX_M]; /* decimation FIR filter memory, then the new samples */
+	FFTR_STATE    fftr_cfg;          /* kiss real FFT config         */
 	std::vector<float> Sn16k;	     /* Fs=16kHz input speech vector */
 };
 
@@ -78,7 +78,7 @@ public:
 	void codec2_fft_inplace(FFT_STATE &cfg, std::complex<float> *inout);
 
 private:
-	float post_process_sub_multiples(std::complex<float> Fw[], int pmax, float gmax, int gmax_bin, float *prev_f0);
+	float post_process_sub_multiples(float Fw[], int pmax, float gmax, int gmax_bin, float *prev_f0);
 	void fdmdv_16_to_8(float out8k[], float in16k[], int n);
 
 	NLP snlp;
@@ -1,8 +1,13 @@
 #include <assert.h>
 #include <math.h>
+#include <string.h>
 
 #include "qbase.h"
 
+/* GCC generic vectors, for the scalar codebooks */
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int v4si __attribute__((vector_size(16)));
+
 /*---------------------------------------------------------------------------*\
 
   quantise
@@ -11,6 +16,12 @@
   returns the vector index.  The squared error of the quantised vector
   is added to se.
 
+  The scalar codebooks are searched four entries at a time.  They are in
+  ascending order (see codebooks.cpp), so the error falls to its minimum
+  and then never falls again, and the search stops as soon as it rises.
+  The errors are worked out just as they are one at a time, and ties go
+  to the first entry, so the index is always the same.
+
 \*---------------------------------------------------------------------------*/
 
 long CQbase::quantise(const float *cb, float vec[], float w[], int k, int m, float *se)
@@ -30,6 +41,37 @@ long CQbase::quantise(const float *cb, float vec[], float w[], int k, int m, flo
 
 	besti = 0;
 	beste = 1E32;
+
+	if (1 == k)
+	{
+		const v4sf v4 = { vec[0], vec[0], vec[0], vec[0] };
+		const v4sf w4 = { w[0], w[0], w[0], w[0] };
+		v4sf e4 = { beste, beste, beste, beste };
+		v4si i4 = { 0, 0, 0, 0 };
+		for(j=0; j<m; j+=4)
+		{
+			v4sf c;
+			memcpy(&c, cb+j, sizeof(c));
+			const v4sf d = c - v4;
+			const v4sf e = (d*w4 * d*w4);
+			const v4si better = e < e4;
+			e4 = better ? e : e4;
+			i4 = better ? v4si { int(j), int(j+1), int(j+2), int(j+3) } : i4;
+			if (e[3] > e[0])
+				break;	/* past the minimum */
+		}
+		for(i=0; i<4; i++)
+		{
+			if (e4[i] < beste || (e4[i] == beste && i4[i] < besti))
+			{
+				beste = e4[i];
+				besti = i4[i];
+			}
+		}
+		*se += beste;
+		return besti;
+	}
+
 	for(j=0; j<m; j++)
 	{
 		e = 0.0;
@@ -58,6 +58,7 @@ public:
 	void bw_expand_lsps(float lsp[], int order, float min_sep_low, float min_sep_high);
 
 private:
+	friend class CCodec2Bench;	// bench/Codec2Bench.cpp times lpc_to_lsp
 	void compute_weights(const float *x, float *w, int ndim);
 	int find_nearest(const float *codebook, int nb_entries, float *x, int ndim);
 	void lpc_post_filter(FFTR_STATE *fftr_fwd_cfg, float Pw[], float ak[], int order, float beta, float gamma, int bass_boost, float E);